@@ -1,10 +1,26 @@
 #include <stdio.h>
 #include <iostream>
+#include <mutex>
+#include <atomic>
 
+#include <llvm/Option/ArgList.h>
+#include <llvm/Option/OptTable.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <clang/Driver/Options.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
 #include <clang/Tooling/Tooling.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 
 #include "analyzer.h"
+#include "CompactDiagnosticConsumer.h"
+#include "CachingFileSystem.h"
+#include "ModuleCache.h"
+#include "PrecompiledHeaderCache.h"
 
 using namespace llvm;
 using namespace clang;
@@ -22,25 +38,307 @@ static cl::list<std::string> FilterOption("filter",
                                           cl::desc("Class name to filter output"),
                                           cl::cat(NullarihyonCategory));
 
+static cl::list<std::string> CheckFileOption("check-file",
+                                             cl::desc("Additional file whose implementations are checked (main file is always checked)"),
+                                             cl::cat(NullarihyonCategory));
+
+static cl::list<std::string> NullabilityRulesOption("nullability-rules",
+                                                    cl::desc("File of selectors whose results are nonnull (or nullable)"),
+                                                    cl::cat(NullarihyonCategory));
+
+static cl::list<std::string> DisableCheckOption("disable-check",
+                                                cl::desc("Disable check: redundant-cast, cast-base-type, redundant-conditional, collection-literal, block-type, or initializer"),
+                                                cl::CommaSeparated,
+                                                cl::cat(NullarihyonCategory));
+
+static cl::opt<bool> CompactOption("compact",
+                                   cl::desc("Print one line per diagnostic, and suppress compiler's own warnings"),
+                                   cl::cat(NullarihyonCategory));
+
+static cl::opt<bool> CaretsOption("carets",
+                                  cl::desc("Print source line and caret in compact output"),
+                                  cl::cat(NullarihyonCategory));
+
+static cl::opt<unsigned> JobsOption("j",
+                                    cl::desc("Number of files analyzed in parallel, or number of threads checking methods if one file is given"),
+                                    cl::init(1),
+                                    cl::cat(NullarihyonCategory));
+
+static cl::opt<bool> PrebuildModulesOption("prebuild-modules",
+                                           cl::desc("Build modules imported by the files into the module cache before analysis"),
+                                           cl::cat(NullarihyonCategory));
+
+static cl::opt<bool> PrebuildOnlyOption("prebuild-only",
+                                        cl::desc("Build caches given by other options (module cache if none), and exit without analysis"),
+                                        cl::cat(NullarihyonCategory));
+
+static cl::opt<std::string> ModuleCacheOption("module-cache-dir",
+                                              cl::desc("Directory of modules shared by analyses (default: nullarihyon-modules in temporary directory)"),
+                                              cl::cat(NullarihyonCategory));
+
+static cl::opt<bool> PrebuildPCHOption("prebuild-pch",
+                                       cl::desc("Build precompiled headers of prefix headers into the PCH cache before analysis"),
+                                       cl::cat(NullarihyonCategory));
+
+static cl::opt<std::string> PCHCacheOption("pch-cache-dir",
+                                           cl::desc("Directory of precompiled prefix headers shared by analyses (default: nullarihyon-pch in temporary directory)"),
+                                           cl::cat(NullarihyonCategory));
+
+static cl::opt<std::string> PrefixHeaderOption("prefix-header",
+                                               cl::desc("Prefix header given by -include in compile commands, which is precompiled"),
+                                               cl::cat(NullarihyonCategory));
+
+/**
+ Creates a fresh action for each translation unit, with settings of the prototype.
+ */
 class NullCheckActionFactory : public FrontendActionFactory {
 public:
-    explicit NullCheckActionFactory(NullCheckAction *action) {
-        Action = std::unique_ptr<NullCheckAction>(action);
-    }
+    explicit NullCheckActionFactory(const NullCheckAction &prototype) : Prototype(prototype) {}
     
     FrontendAction *create() override {
-        return std::move(Action).get();
+        return Prototype.clone().release();
     }
     
 private:
-    std::unique_ptr<NullCheckAction> Action;
+    const NullCheckAction &Prototype;
 };
 
+/**
+ Runs the tool action, without the summary of warnings and errors which CompilerInstance writes to stderr.
+ Caller writes the summary with the diagnostics of the file instead.
+ */
+class NoSummaryToolAction : public ToolAction {
+public:
+    explicit NoSummaryToolAction(ToolAction &action) : Action(action), ShowSummary(false) {}
+    
+    bool runInvocation(CompilerInvocation *invocation, FileManager *files, std::shared_ptr<PCHContainerOperations> pchContainerOps, DiagnosticConsumer *diagnosticConsumer) override {
+        ShowSummary = invocation->getDiagnosticOpts().ShowCarets;
+        invocation->getDiagnosticOpts().ShowCarets = false;
+        
+        return Action.runInvocation(invocation, files, pchContainerOps, diagnosticConsumer);
+    }
+    
+    bool showsSummary() const {
+        return ShowSummary;
+    }
+    
+private:
+    ToolAction &Action;
+    bool ShowSummary;
+};
+
+/**
+ Diagnostic options of command line, parsed as ToolInvocation does for its own printer, so that output is the same as ClangTool.
+ */
+static IntrusiveRefCntPtr<DiagnosticOptions> parseDiagnosticOptions(const std::vector<std::string> &commandLine) {
+    std::vector<const char *> argv;
+    for (auto &arg : commandLine) {
+        argv.push_back(arg.c_str());
+    }
+    
+    IntrusiveRefCntPtr<DiagnosticOptions> options(new DiagnosticOptions());
+    
+    unsigned missingArgIndex, missingArgCount;
+    std::unique_ptr<opt::OptTable> table(driver::createDriverOptTable());
+    opt::InputArgList args = table->ParseArgs(makeArrayRef(argv).slice(1), missingArgIndex, missingArgCount);
+    ParseDiagnosticArgs(*options, args);
+    
+    return options;
+}
+
+static DiagnosticConsumer *newDiagnosticConsumer(raw_ostream &os, DiagnosticOptions *options) {
+    if (CompactOption) {
+        return new CompactDiagnosticConsumer(os, CaretsOption);
+    } else {
+        return new TextDiagnosticPrinter(os, options);
+    }
+}
+
+/**
+ Runs the action on a file, as ClangTool does, with the given FileManager.
+ Diagnostics and summaries are written to os.
+ */
+static bool runInvocation(const CompilationDatabase &compilations, const std::string &path, FileManager &files, FrontendActionFactory &factory, raw_ostream &os) {
+    // Resource directory is found relative to the executable
+    static int StaticSymbol;
+    std::string mainExecutable = llvm::sys::fs::getMainExecutable("nullarihyon-core", &StaticSymbol);
+    
+    ArgumentsAdjuster adjuster = combineAdjusters(getClangStripOutputAdjuster(), getClangSyntaxOnlyAdjuster());
+    
+    std::vector<CompileCommand> commands = compilations.getCompileCommands(path);
+    if (commands.empty()) {
+        os << "Skipping " << path << ". Compile command not found.\n";
+        return true;
+    }
+    
+    bool success = true;
+    
+    for (auto &command : commands) {
+        std::vector<std::string> commandLine = adjuster(command.CommandLine);
+        commandLine[0] = mainExecutable;
+        
+        IntrusiveRefCntPtr<DiagnosticOptions> options = parseDiagnosticOptions(commandLine);
+        std::unique_ptr<DiagnosticConsumer> diagnosticConsumer(newDiagnosticConsumer(os, options.get()));
+        
+        NoSummaryToolAction action(factory);
+        ToolInvocation invocation(std::move(commandLine), &action, &files);
+        invocation.setDiagnosticConsumer(diagnosticConsumer.get());
+        
+        if (!invocation.run()) {
+            success = false;
+        }
+        
+        if (action.showsSummary()) {
+            // Same as CompilerInstance::ExecuteAction
+            unsigned numWarnings = diagnosticConsumer->getNumWarnings();
+            unsigned numErrors = diagnosticConsumer->getNumErrors();
+            
+            if (numWarnings) {
+                os << numWarnings << " warning" << (numWarnings == 1 ? "" : "s");
+            }
+            if (numWarnings && numErrors) {
+                os << " and ";
+            }
+            if (numErrors) {
+                os << numErrors << " error" << (numErrors == 1 ? "" : "s");
+            }
+            if (numWarnings || numErrors) {
+                os << " generated.\n";
+            }
+        }
+    }
+    
+    return success;
+}
+
+/**
+ Analyzes files one by one with ClangTool.
+ */
+static int runSerial(const CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths, const NullCheckAction &prototype) {
+    ClangTool Tool(compilations, sourcePaths);
+    
+    std::unique_ptr<CompactDiagnosticConsumer> diagnosticConsumer;
+    if (CompactOption) {
+        diagnosticConsumer.reset(new CompactDiagnosticConsumer(llvm::errs(), CaretsOption));
+        Tool.setDiagnosticConsumer(diagnosticConsumer.get());
+    }
+    
+    NullCheckActionFactory factory(prototype);
+    
+    return Tool.run(&factory);
+}
+
+/**
+ Paths of the command where modules, PCH, their locks and outputs are written during analyses; they are not cached by CachingFileSystem.
+ */
+static void collectUncachedPrefixes(const CompileCommand &command, std::vector<std::string> &prefixes) {
+    auto addPath = [&](StringRef path) {
+        if (path.empty()) {
+            return;
+        }
+        
+        SmallString<256> absolutePath(path);
+        if (!llvm::sys::path::is_absolute(absolutePath)) {
+            absolutePath = command.Directory;
+            llvm::sys::path::append(absolutePath, path);
+        }
+        prefixes.push_back(absolutePath.str());
+    };
+    
+    StringRef cachePathOption = "-fmodules-cache-path=";
+    
+    const std::vector<std::string> &commandLine = command.CommandLine;
+    for (size_t index = 0; index < commandLine.size(); index++) {
+        StringRef arg = commandLine[index];
+        
+        if (arg.startswith(cachePathOption)) {
+            addPath(arg.substr(cachePathOption.size()));
+        }
+        if ((arg == "-include-pch" || arg == "-o") && index + 1 < commandLine.size()) {
+            addPath(llvm::sys::path::parent_path(commandLine[index + 1]));
+        }
+    }
+}
+
+/**
+ Analyzes files with a thread pool. Each thread has its own FileManager, which is reused for the files the thread analyzes.
+ FileManagers share one file system which caches status of paths, so that header search of a file does not repeat system calls of other files.
+ Diagnostics of a file are buffered, and written at once when the file is done.
+ */
+static int runParallel(const CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths, const NullCheckAction &prototype, unsigned jobs) {
+    std::vector<std::string> paths;
+    std::string directory;
+    
+    // Default module cache of clang, org.llvm.clang.<user>/ModuleCache in temporary directory
+    SmallString<256> defaultModuleCachePrefix;
+    llvm::sys::path::system_temp_directory(false, defaultModuleCachePrefix);
+    llvm::sys::path::append(defaultModuleCachePrefix, "org.llvm.clang.");
+    std::vector<std::string> uncachedPrefixes{ defaultModuleCachePrefix.str() };
+    
+    for (auto &path : sourcePaths) {
+        SmallString<256> absolutePath(path);
+        llvm::sys::fs::make_absolute(absolutePath);
+        paths.push_back(absolutePath.str());
+        
+        for (auto &command : compilations.getCompileCommands(absolutePath)) {
+            if (directory.empty()) {
+                directory = command.Directory;
+            } else if (directory != command.Directory) {
+                // Working directory of the process is shared by threads
+                llvm::errs() << "Files compiled in different directories cannot be analyzed in parallel; analyzing serially\n";
+                return runSerial(compilations, sourcePaths, prototype);
+            }
+            
+            collectUncachedPrefixes(command, uncachedPrefixes);
+        }
+    }
+    
+    if (!directory.empty()) {
+        // Real file system changes working directory of the process
+        vfs::getRealFileSystem()->setCurrentWorkingDirectory(directory);
+    }
+    
+    IntrusiveRefCntPtr<CachingFileSystem> fileSystem(new CachingFileSystem(vfs::getRealFileSystem()));
+    for (auto &prefix : uncachedPrefixes) {
+        fileSystem->addUncachedPrefix(prefix);
+    }
+    
+    std::mutex outputMutex;
+    std::atomic<int> status(0);
+    std::atomic<size_t> nextPath(0);
+    
+    unsigned numThreads = std::min<size_t>(jobs, paths.size());
+    ThreadPool pool(numThreads);
+    
+    for (unsigned i = 0; i < numThreads; i++) {
+        pool.async([&] {
+            IntrusiveRefCntPtr<FileManager> files(new FileManager(FileSystemOptions(), fileSystem));
+            NullCheckActionFactory factory(prototype);
+            
+            for (size_t index = nextPath++; index < paths.size(); index = nextPath++) {
+                std::string output;
+                llvm::raw_string_ostream os(output);
+                
+                if (!runInvocation(compilations, paths[index], *files, factory, os)) {
+                    status = 1;
+                }
+                
+                os.flush();
+                
+                std::lock_guard<std::mutex> lock(outputMutex);
+                llvm::errs() << output;
+            }
+        });
+    }
+    
+    pool.wait();
+    
+    return status;
+}
+
 int main(int argc, const char **argv) {
     CommonOptionsParser OptionsParser(argc, argv, NullarihyonCategory);
-    ClangTool Tool(OptionsParser.getCompilations(), OptionsParser.getSourcePathList());
-    
-    auto action = new NullCheckAction;
+    std::unique_ptr<NullCheckAction> action(new NullCheckAction);
     action->setDebug(DebugOption);
     
     for (auto f : FilterOption) {
@@ -48,7 +346,12 @@ int main(int argc, const char **argv) {
             f.erase(f.begin());
             f.erase(f.end()-1);
             
-            std::shared_ptr<RegexpFilteringClause> clause{ new RegexpFilteringClause(std::regex(f)) };
+            std::shared_ptr<RegexpFilteringClause> clause{ new RegexpFilteringClause(f) };
+            std::string error;
+            if (!clause->isValid(error)) {
+                llvm::errs() << "Invalid filter /" << f << "/: " << error << "\n";
+                return 1;
+            }
             action->addFilterClause(clause);
         } else {
             std::shared_ptr<TextFilteringClause> clause{ new TextFilteringClause(f) };
@@ -56,7 +359,87 @@ int main(int argc, const char **argv) {
         }
     }
     
-    NullCheckActionFactory *factory = new NullCheckActionFactory(action);
+    for (auto &path : CheckFileOption) {
+        action->addCheckedFile(path);
+    }
+    
+    SelectorNullabilityRules rules;
+    for (auto &path : NullabilityRulesOption) {
+        std::string error;
+        if (!rules.loadFile(path, error)) {
+            llvm::errs() << error << "\n";
+            return 1;
+        }
+    }
+    action->setSelectorNullabilityRules(rules);
+    
+    NullabilityCheckSet checks;
+    for (auto &name : DisableCheckOption) {
+        if (!checks.disable(name)) {
+            llvm::errs() << "Unknown check: " << name << "\n";
+            return 1;
+        }
+    }
+    action->setChecks(checks);
+    
+    const CompilationDatabase *compilations = &OptionsParser.getCompilations();
+    
+    bool useModuleCache = PrebuildModulesOption || !ModuleCacheOption.empty();
+    bool usePCHCache = PrebuildPCHOption || !PCHCacheOption.empty();
+    if (usePCHCache && PrefixHeaderOption.empty()) {
+        llvm::errs() << "-prebuild-pch and -pch-cache-dir require -prefix-header\n";
+        return 1;
+    }
+    if (PrebuildOnlyOption && !usePCHCache) {
+        useModuleCache = true;
+    }
+    
+    bool prebuildSucceeded = true;
+    
+    std::unique_ptr<ModuleCache> moduleCache;
+    std::unique_ptr<AdjustedCompilationDatabase> moduleCacheCompilations;
+    if (useModuleCache) {
+        moduleCache.reset(new ModuleCache(ModuleCacheOption.empty() ? ModuleCache::defaultRootPath() : std::string(ModuleCacheOption)));
+        
+        if (PrebuildModulesOption || PrebuildOnlyOption) {
+            prebuildSucceeded &= moduleCache->prebuild(*compilations, OptionsParser.getSourcePathList());
+        }
+        
+        ModuleCache *cache = moduleCache.get();
+        moduleCacheCompilations.reset(new AdjustedCompilationDatabase(*compilations, [cache](const std::vector<std::string> &commandLine, StringRef directory, StringRef filePath) {
+            return cache->adjustCommandLine(commandLine, directory, filePath);
+        }));
+        compilations = moduleCacheCompilations.get();
+    }
+    
+    // PCH is built after modules, with the module cache it imports from
+    std::unique_ptr<PrecompiledHeaderCache> pchCache;
+    std::unique_ptr<AdjustedCompilationDatabase> pchCacheCompilations;
+    if (usePCHCache) {
+        pchCache.reset(new PrecompiledHeaderCache(PCHCacheOption.empty() ? PrecompiledHeaderCache::defaultRootPath() : std::string(PCHCacheOption), PrefixHeaderOption));
+        
+        if (PrebuildPCHOption || PrebuildOnlyOption) {
+            prebuildSucceeded &= pchCache->prebuild(*compilations, OptionsParser.getSourcePathList());
+        }
+        
+        PrecompiledHeaderCache *cache = pchCache.get();
+        pchCacheCompilations.reset(new AdjustedCompilationDatabase(*compilations, [cache](const std::vector<std::string> &commandLine, StringRef directory, StringRef filePath) {
+            return cache->adjustCommandLine(commandLine, directory, filePath);
+        }));
+        compilations = pchCacheCompilations.get();
+    }
+    
+    if (PrebuildOnlyOption) {
+        return prebuildSucceeded ? 0 : 1;
+    }
+    
+    if (JobsOption > 1) {
+        if (OptionsParser.getSourcePathList().size() > 1) {
+            return runParallel(*compilations, OptionsParser.getSourcePathList(), *action, JobsOption);
+        } else {
+            action->setMethodJobs(JobsOption);
+        }
+    }
     
-    return Tool.run(factory);
+    return runSerial(*compilations, OptionsParser.getSourcePathList(), *action);
 }
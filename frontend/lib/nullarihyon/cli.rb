@@ -23,6 +23,8 @@ module Nullarihyon
     option :block_assertions, type: :boolean, default: true, desc: "Ignore NSAssert family"
     option :arch, type: :string
     option :filter, type: :array, default: [], desc: "Specify filter"
+    option :rules, type: :array, default: [], desc: "Files of selector nullability rules"
+    option :disable_check, type: :array, default: [], desc: "Checks to disable (redundant-cast, cast-base-type, redundant-conditional, collection-literal, block-type, initializer)"
     def check(*files)
       config = Configuration.new(Pathname(options[:analyzer]).realpath, Pathname(options[:resource_dir]).realpath)
       config.arc_enabled = options[:arc]
@@ -35,6 +37,14 @@ module Nullarihyon
         config.add_filter filter
       end
 
+      options[:rules].each do |path|
+        config.add_nullability_rules_path Pathname(path).realpath
+      end
+
+      options[:disable_check].each do |name|
+        config.disable_check name
+      end
+
       if options[:sdk]
         config.sysroot_path = CLI.sdks[options[:sdk]]
       end
@@ -14,8 +14,14 @@ module Nullarihyon
     attr_reader :other_flags
 
     attr_accessor :debug
+    attr_accessor :compact_output
+    attr_accessor :module_cache_path
+    attr_accessor :pch_cache_path
+    attr_accessor :prefix_header_path
 
     attr_reader :filters
+    attr_reader :nullability_rules_paths
+    attr_reader :disabled_checks
 
     def initialize(analyzer_path, resource_dir_path)
       @analyzer_path = analyzer_path
@@ -25,10 +31,13 @@ module Nullarihyon
       modules_enabled = true
       assertions_blocked = true
       debug = false
+      compact_output = false
 
       @header_search_paths = []
       @other_flags = []
       @filters = []
+      @nullability_rules_paths = []
+      @disabled_checks = []
     end
 
     def add_header_search_path(kind, path)
@@ -39,6 +48,14 @@ module Nullarihyon
       filters << filter
     end
 
+    def add_nullability_rules_path(path)
+      nullability_rules_paths << path
+    end
+
+    def disable_check(name)
+      disabled_checks << name
+    end
+
     def add_other_flag(*args)
       case args.size
       when 0
@@ -61,10 +78,34 @@ module Nullarihyon
         array << "-debug"
       end
 
+      if compact_output
+        array << "-compact"
+      end
+
       filters.each do |filter|
         array << ["-filter", filter]
       end
 
+      nullability_rules_paths.each do |path|
+        array << ["-nullability-rules", path.to_s]
+      end
+
+      disabled_checks.each do |name|
+        array << "-disable-check=#{name}"
+      end
+
+      if module_cache_path
+        array << "-module-cache-dir=#{module_cache_path}"
+      end
+
+      if pch_cache_path
+        array << "-pch-cache-dir=#{pch_cache_path}"
+      end
+
+      if prefix_header_path
+        array << "-prefix-header=#{prefix_header_path}"
+      end
+
       array << "--"
 
       array << ["-resource-dir", resource_dir_path.to_s]
@@ -104,6 +145,13 @@ module Nullarihyon
       array
     end
 
+    # Builds modules imported by files and precompiled prefix header into the caches, without analysis
+    def prebuild_commandline(*files)
+      commandline(*files).tap do |array|
+        array.insert(array.index("--"), "-prebuild-only")
+      end
+    end
+
     def self.sdk_paths(xcode_path)
       # Prefer simulator SDKs
       platform_names = %w(AppleTVSimulator MacOSX WatchSimulator iPhoneSimulator)
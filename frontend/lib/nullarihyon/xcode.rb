@@ -70,6 +70,11 @@ module Nullarihyon
       end
     end
 
+    def nullability_rules_path
+      path = project_path.parent + "nullrules"
+      path if path.file?
+    end
+
     def prefix_header_path
       if env["GCC_PRECOMPILE_PREFIX_HEADER"] == "YES"
         Pathname(env["GCC_PREFIX_HEADER"])
@@ -81,6 +86,16 @@ module Nullarihyon
       Dir.glob((temp_dir_path + "*.hmap").to_s)
     end
 
+    # Modules are built once before analyzers start, and shared by analyzers
+    def module_cache_path
+      objects_dir_path + "nullarihyon-modules"
+    end
+
+    # Prefix header is precompiled once for the configuration, and rebuilt only if it or headers it imports are updated
+    def pch_cache_path
+      objects_dir_path + "nullarihyon-pch"
+    end
+
     def preprocessor_definitions
       self.class.tokenize_command_line(env["GCC_PREPROCESSOR_DEFINITIONS"])
     end
@@ -93,11 +108,21 @@ module Nullarihyon
         config.modules_enabled = modules_enabled?
         config.assertions_blocked = true
         config.debug = debug
+        # Xcode shows compiler warnings by itself; print only nullarihyon's
+        config.compact_output = true
+
+        if modules_enabled?
+          config.module_cache_path = module_cache_path
+        end
 
         filters.each do |filter|
           config.add_filter filter
         end
 
+        if nullability_rules_path
+          config.add_nullability_rules_path nullability_rules_path
+        end
+
         framework_search_paths.each do |path|
           config.add_header_search_path :framework, path
         end
@@ -123,7 +148,10 @@ module Nullarihyon
         end
 
         if prefix_header_path && prefix_header_path.file?
+          # OTHER_CFLAGS may have -include too; analyzer finds the prefix header by its path
           config.add_other_flag "-include", prefix_header_path.realpath.to_s
+          config.prefix_header_path = prefix_header_path.realpath
+          config.pch_cache_path = pch_cache_path
         end
       end
     end
@@ -157,6 +185,17 @@ module Nullarihyon
       Open3.capture2e(*commandline)
     end
 
+    def run_prebuild(commandline)
+      Open3.capture2e(*commandline)
+    end
+
+    def prebuild_caches(config, sources)
+      return unless config.module_cache_path || config.pch_cache_path
+      return if sources.empty?
+
+      run_prebuild(config.prebuild_commandline(*sources).flatten)
+    end
+
     def check(config, source, objects_dir, force)
       io = StringIO.new
 
@@ -197,6 +236,8 @@ module Nullarihyon
 
       force = config_updated?(objects_dir, config)
 
+      prebuild_caches(config, sources.select {|path| force || need_check?(path, objects_dir) })
+
       input_queue = Queue.new
       output_queue = Queue.new
 
@@ -207,6 +248,7 @@ module Nullarihyon
         input_queue << :done
       end
 
+      # One analyzer process for each file, so that output of each file is saved as its last check result
       workers = jobs.times.map do
         Thread.new do
           loop do
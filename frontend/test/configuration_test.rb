@@ -115,6 +115,58 @@ module Nullarihyon
           assert config.commandline.include?(["-filter", "FooClass"])
           assert config.commandline.include?(["-filter", "BarClass"])
         end
+
+        it "contains -nullability-rules flags" do
+          config.add_nullability_rules_path @dir + "rules"
+
+          assert config.commandline.include?(["-nullability-rules", (@dir + "rules").to_s])
+        end
+
+        it "contains -compact flag if compact output" do
+          config.compact_output = true
+
+          assert config.commandline.include?("-compact")
+        end
+
+        it "contains -disable-check flags" do
+          config.disable_check "redundant-cast"
+
+          assert config.commandline.include?("-disable-check=redundant-cast")
+        end
+
+        it "contains -module-cache-dir flag if module cache path is given" do
+          config.module_cache_path = @dir + "modules"
+
+          assert config.commandline.include?("-module-cache-dir=#{@dir + "modules"}")
+        end
+
+        it "contains -pch-cache-dir flag if PCH cache path is given" do
+          config.pch_cache_path = @dir + "pch"
+
+          commandline = config.commandline
+
+          assert commandline.include?("-pch-cache-dir=#{@dir + "pch"}")
+          assert commandline.index("-pch-cache-dir=#{@dir + "pch"}") < commandline.index("--")
+        end
+
+        it "contains -prefix-header flag before -- if prefix header is given" do
+          config.prefix_header_path = @dir + "Prefix.pch"
+
+          commandline = config.commandline
+
+          assert commandline.index("-prefix-header=#{@dir + "Prefix.pch"}") < commandline.index("--")
+        end
+      end
+
+      describe "#prebuild_commandline" do
+        it "contains -prebuild-only flag before --" do
+          config.module_cache_path = @dir + "modules"
+
+          commandline = config.prebuild_commandline("a.m")
+
+          assert commandline.index("-prebuild-only") < commandline.index("--")
+          assert commandline.include?("a.m")
+        end
       end
 
       describe ".sdk_paths" do
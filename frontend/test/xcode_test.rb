@@ -105,6 +105,33 @@ module Nullarihyon
         assert xcode.configuration.debug
       end
 
+      it "uses compact output" do
+        assert xcode.configuration.compact_output
+      end
+
+      it "has no module cache path if modules are disabled" do
+        assert_nil xcode.configuration.module_cache_path
+      end
+
+      it "has module cache path in objects dir if modules are enabled" do
+        xcode = Xcode.new(@analyzer_path, @resource_dir_path, 1, false, env.merge("CLANG_ENABLE_MODULES" => "YES"))
+
+        assert_equal @objects_dir_path + "nullarihyon-modules", xcode.configuration.module_cache_path
+      end
+
+      it "has no PCH cache path without prefix header" do
+        assert_nil xcode.configuration.pch_cache_path
+      end
+
+      it "has PCH cache path in objects dir if prefix header is precompiled" do
+        prefix_header = (Pathname(__dir__) + "data/TestProgram/TestProgram/AppDelegate.h").realpath
+        xcode = Xcode.new(@analyzer_path, @resource_dir_path, 1, false, env.merge("GCC_PREFIX_HEADER" => prefix_header.to_s,
+                                                                                  "GCC_PRECOMPILE_PREFIX_HEADER" => "YES"))
+
+        assert_equal @objects_dir_path + "nullarihyon-pch", xcode.configuration.pch_cache_path
+        assert_equal prefix_header, xcode.configuration.prefix_header_path
+      end
+
       it "reads filters from nullfilter file" do
         filter_path = (Pathname(__dir__) + "data/TestProgram").realpath + "nullfilter"
 
@@ -120,6 +147,20 @@ module Nullarihyon
         end
       end
 
+      it "reads nullability rules from nullrules file" do
+        rules_path = (Pathname(__dir__) + "data/TestProgram").realpath + "nullrules"
+
+        begin
+          rules_path.open("w") do |io|
+            io.puts "-sharedStore"
+          end
+
+          assert_equal [rules_path], xcode.configuration.nullability_rules_paths
+        ensure
+          rules_path.unlink
+        end
+      end
+
       it "has preprocessor definitions from ENV" do
         env["GCC_PREPROCESSOR_DEFINITIONS"] = "A=1 B=2"
         flags = xcode.configuration.other_flags
@@ -305,6 +346,51 @@ module Nullarihyon
         ].sort, trace.sort)
       end
 
+      it "prebuilds modules once before analyzers if modules are enabled" do
+        xcode = Xcode.new(@analyzer_path, @resource_dir_path, 2, false, env.merge("CLANG_ENABLE_MODULES" => "YES"))
+
+        prebuilds = []
+
+        xcode.define_singleton_method :run_prebuild do |commandline|
+          prebuilds << commandline
+          ["", 0]
+        end
+
+        xcode.define_singleton_method :run_analyzer do |source, _|
+          ["Check result for #{source}\n", 0]
+        end
+
+        xcode.run(StringIO.new)
+
+        assert_equal 1, prebuilds.size
+        assert prebuilds.first.include?("-prebuild-only")
+        assert prebuilds.first.include?("-module-cache-dir=#{@objects_dir_path + "nullarihyon-modules"}")
+      end
+
+      it "prebuilds precompiled prefix header before analyzers" do
+        prefix_header = (Pathname(__dir__) + "data/TestProgram/TestProgram/AppDelegate.h").realpath
+        xcode = Xcode.new(@analyzer_path, @resource_dir_path, 2, false, env.merge("GCC_PREFIX_HEADER" => prefix_header.to_s,
+                                                                                  "GCC_PRECOMPILE_PREFIX_HEADER" => "YES"))
+
+        prebuilds = []
+
+        xcode.define_singleton_method :run_prebuild do |commandline|
+          prebuilds << commandline
+          ["", 0]
+        end
+
+        xcode.define_singleton_method :run_analyzer do |source, _|
+          ["Check result for #{source}\n", 0]
+        end
+
+        xcode.run(StringIO.new)
+
+        assert_equal 1, prebuilds.size
+        assert prebuilds.first.include?("-pch-cache-dir=#{@objects_dir_path + "nullarihyon-pch"}")
+        assert prebuilds.first.include?("-prefix-header=#{prefix_header}")
+        assert prebuilds.first.include?(prefix_header.to_s)
+      end
+
       it "executes for all files if configuration is updated" do
         test_program_dir = (Pathname(__dir__) + "data/TestProgram").realpath
         objects_dir_path = xcode.objects_dir_path
@@ -0,0 +1,91 @@
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/Path.h>
+
+#include "CachingFileSystem.h"
+
+using namespace clang;
+
+std::string CachingFileSystem::cacheKey(const llvm::Twine &path) const {
+    // Relative paths are keyed with working directory, which is shared by threads
+    llvm::SmallString<256> key;
+    path.toVector(key);
+    makeAbsolute(key);
+    
+    return key.str();
+}
+
+bool CachingFileSystem::isCacheable(llvm::StringRef key) const {
+    // Modules, PCH and their lock and timestamp files are created and rebuilt by analyses during the batch
+    bool builtFile = llvm::StringSwitch<bool>(llvm::sys::path::extension(key))
+    .Cases(".pcm", ".pch", ".timestamp", ".lock", ".idx", true)
+    .Default(false);
+    if (builtFile) {
+        return false;
+    }
+    
+    for (auto &prefix : _UncachedPrefixes) {
+        if (key.startswith(prefix)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool CachingFileSystem::lookup(llvm::StringRef key, llvm::ErrorOr<vfs::Status> &status) {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    
+    auto it = _Statuses.find(key);
+    if (it == _Statuses.end()) {
+        return false;
+    }
+    
+    status = it->second;
+    return true;
+}
+
+void CachingFileSystem::store(llvm::StringRef key, const llvm::ErrorOr<vfs::Status> &status) {
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Statuses.insert(std::make_pair(key, status));
+}
+
+llvm::ErrorOr<vfs::Status> CachingFileSystem::status(const llvm::Twine &path) {
+    std::string key = cacheKey(path);
+    if (!isCacheable(key)) {
+        return _FS->status(path);
+    }
+    
+    llvm::ErrorOr<vfs::Status> status = std::make_error_code(std::errc::no_such_file_or_directory);
+    if (!lookup(key, status)) {
+        // Underlying file system is not locked; another thread may store the same status meanwhile
+        status = _FS->status(key);
+        store(key, status);
+    }
+    
+    if (status) {
+        // Status is named by the path given, as underlying file system does
+        return vfs::Status::copyWithNewName(*status, path.str());
+    } else {
+        return status;
+    }
+}
+
+llvm::ErrorOr<std::unique_ptr<vfs::File>> CachingFileSystem::openFileForRead(const llvm::Twine &path) {
+    std::string key = cacheKey(path);
+    if (!isCacheable(key)) {
+        return _FS->openFileForRead(path);
+    }
+    
+    llvm::ErrorOr<vfs::Status> status = std::make_error_code(std::errc::no_such_file_or_directory);
+    if (lookup(key, status) && !status) {
+        return status.getError();
+    }
+    
+    auto file = _FS->openFileForRead(path);
+    if (!file) {
+        store(key, file.getError());
+    }
+    
+    return file;
+}
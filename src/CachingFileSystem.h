@@ -0,0 +1,58 @@
+#ifndef CachingFileSystem_h
+#define CachingFileSystem_h
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <clang/Basic/VirtualFileSystem.h>
+
+/**
+ File system which memoizes status of paths, including paths which do not exist, on top of another file system.
+ Translation units in a batch look up the same SDK, framework and header map paths; one instance is shared by them, and by threads.
+ Files are assumed not to be added or removed during the batch, except module files, PCH, and files under uncached prefixes (caches and outputs),
+ which are always looked up in underlying file system, so that files built by analyses are found.
+ */
+class CachingFileSystem : public clang::vfs::FileSystem {
+    llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> _FS;
+    llvm::StringMap<llvm::ErrorOr<clang::vfs::Status>> _Statuses;
+    std::mutex _Mutex;
+    std::vector<std::string> _UncachedPrefixes;
+    
+    bool isCacheable(llvm::StringRef key) const;
+    bool lookup(llvm::StringRef key, llvm::ErrorOr<clang::vfs::Status> &status);
+    void store(llvm::StringRef key, const llvm::ErrorOr<clang::vfs::Status> &status);
+    std::string cacheKey(const llvm::Twine &path) const;
+
+public:
+    explicit CachingFileSystem(llvm::IntrusiveRefCntPtr<clang::vfs::FileSystem> fs) : _FS(fs) {}
+    
+    /**
+     Paths starting with prefix (like a module cache directory) are not cached. Prefixes should be added before lookups start.
+     */
+    void addUncachedPrefix(llvm::StringRef prefix) {
+        _UncachedPrefixes.push_back(prefix);
+    }
+    
+    llvm::ErrorOr<clang::vfs::Status> status(const llvm::Twine &path) override;
+    
+    /**
+     Cacheable paths known not to exist fail without asking underlying file system; existing files are opened every time.
+     */
+    llvm::ErrorOr<std::unique_ptr<clang::vfs::File>> openFileForRead(const llvm::Twine &path) override;
+    
+    clang::vfs::directory_iterator dir_begin(const llvm::Twine &dir, std::error_code &ec) override {
+        return _FS->dir_begin(dir, ec);
+    }
+    
+    llvm::ErrorOr<std::string> getCurrentWorkingDirectory() const override {
+        return _FS->getCurrentWorkingDirectory();
+    }
+    
+    std::error_code setCurrentWorkingDirectory(const llvm::Twine &path) override {
+        return _FS->setCurrentWorkingDirectory(path);
+    }
+};
+
+#endif
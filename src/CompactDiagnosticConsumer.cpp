@@ -0,0 +1,110 @@
+#include "CompactDiagnosticConsumer.h"
+
+using namespace clang;
+
+static const char *levelName(DiagnosticsEngine::Level level) {
+    switch (level) {
+        case DiagnosticsEngine::Ignored:
+            return "ignored";
+        case DiagnosticsEngine::Note:
+            return "note";
+        case DiagnosticsEngine::Remark:
+            return "remark";
+        case DiagnosticsEngine::Warning:
+            return "warning";
+        case DiagnosticsEngine::Error:
+            return "error";
+        case DiagnosticsEngine::Fatal:
+            return "fatal error";
+    }
+    
+    return "";
+}
+
+CompactDiagnosticConsumer::~CompactDiagnosticConsumer() {
+    flush();
+}
+
+void CompactDiagnosticConsumer::HandleDiagnostic(clang::DiagnosticsEngine::Level level, const clang::Diagnostic &info) {
+    bool report;
+    if (level == DiagnosticsEngine::Note) {
+        // Notes follow the diagnostic they are attached to
+        report = _LastReported;
+    } else {
+        report = level >= DiagnosticsEngine::Error || !DiagnosticIDs::isBuiltinDiag(info.getID());
+        _LastReported = report;
+    }
+    
+    if (!report) {
+        return;
+    }
+    
+    // Count only printed diagnostics, so that "N warnings generated" matches the output
+    DiagnosticConsumer::HandleDiagnostic(level, info);
+    
+    llvm::raw_svector_ostream os(_Buffer);
+    
+    SourceLocation location = info.getLocation();
+    const SourceManager *sourceManager = info.hasSourceManager() ? &info.getSourceManager() : nullptr;
+    
+    if (sourceManager && location.isValid()) {
+        location = sourceManager->getExpansionLoc(location);
+        PresumedLoc presumed = sourceManager->getPresumedLoc(location);
+        if (presumed.isValid()) {
+            os << presumed.getFilename() << ":" << presumed.getLine() << ":" << presumed.getColumn() << ": ";
+        }
+    }
+    
+    llvm::SmallString<128> message;
+    info.FormatDiagnostic(message);
+    
+    os << levelName(level) << ": " << message << "\n";
+    
+    if (_ShowCarets && sourceManager && location.isValid()) {
+        printCaret(os, *sourceManager, location);
+    }
+}
+
+void CompactDiagnosticConsumer::printCaret(llvm::raw_ostream &os, const clang::SourceManager &sourceManager, clang::SourceLocation location) {
+    std::pair<FileID, unsigned> decomposed = sourceManager.getDecomposedLoc(location);
+    
+    bool invalid = false;
+    llvm::StringRef buffer = sourceManager.getBufferData(decomposed.first, &invalid);
+    if (invalid || decomposed.second > buffer.size()) {
+        return;
+    }
+    
+    // rfind looks for newline before the location
+    size_t lineStart = buffer.rfind('\n', decomposed.second);
+    lineStart = lineStart == llvm::StringRef::npos ? 0 : lineStart + 1;
+    
+    size_t lineEnd = buffer.find_first_of("\r\n", decomposed.second);
+    if (lineEnd == llvm::StringRef::npos) {
+        lineEnd = buffer.size();
+    }
+    
+    llvm::StringRef line = buffer.slice(lineStart, lineEnd);
+    os << line << "\n";
+    
+    // Keep tabs so that the caret lines up with the source line
+    for (size_t index = lineStart; index < decomposed.second; index++) {
+        os << (buffer[index] == '\t' ? '\t' : ' ');
+    }
+    os << "^\n";
+}
+
+void CompactDiagnosticConsumer::EndSourceFile() {
+    flush();
+}
+
+void CompactDiagnosticConsumer::finish() {
+    flush();
+}
+
+void CompactDiagnosticConsumer::flush() {
+    if (!_Buffer.empty()) {
+        _OS << _Buffer;
+        _OS.flush();
+        _Buffer.clear();
+    }
+}
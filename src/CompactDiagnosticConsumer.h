@@ -0,0 +1,35 @@
+#ifndef CompactDiagnosticConsumer_h
+#define CompactDiagnosticConsumer_h
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/raw_ostream.h>
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/SourceManager.h>
+
+/**
+ Prints diagnostics as one line records (`file:line:col: warning: message`), for batch runs.
+ Compiler's own warnings are suppressed; only errors are printed in addition to nullarihyon diagnostics.
+ Output is buffered and written at the end of each source file.
+ */
+class CompactDiagnosticConsumer : public clang::DiagnosticConsumer {
+    llvm::raw_ostream &_OS;
+    bool _ShowCarets;
+    bool _LastReported;
+    llvm::SmallString<4096> _Buffer;
+    
+    void printCaret(llvm::raw_ostream &os, const clang::SourceManager &sourceManager, clang::SourceLocation location);
+    
+public:
+    explicit CompactDiagnosticConsumer(llvm::raw_ostream &os, bool showCarets)
+    : _OS(os), _ShowCarets(showCarets), _LastReported(false) {}
+    
+    ~CompactDiagnosticConsumer() override;
+    
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level level, const clang::Diagnostic &info) override;
+    void EndSourceFile() override;
+    void finish() override;
+    
+    void flush();
+};
+
+#endif
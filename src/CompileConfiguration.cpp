@@ -0,0 +1,93 @@
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringSwitch.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <clang/Basic/Version.h>
+
+#include "CompileConfiguration.h"
+
+static std::string normalizedPath(llvm::StringRef directory, llvm::StringRef path) {
+    llvm::SmallString<256> result;
+    
+    if (!llvm::sys::path::is_absolute(path)) {
+        result = directory;
+    }
+    llvm::sys::path::append(result, path);
+    llvm::sys::path::remove_dots(result, true);
+    
+    return result.str();
+}
+
+CompileConfiguration::CompileConfiguration(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath) {
+    std::string source = normalizedPath(directory, sourcePath);
+    
+    for (size_t index = 1; index < commandLine.size(); index++) {
+        llvm::StringRef arg = commandLine[index];
+        
+        // Outputs differ for each file; options with value skip the value too
+        unsigned skip = llvm::StringSwitch<unsigned>(arg)
+        .Cases("-o", "-MF", "-MT", "-MQ", "--serialize-diagnostics", 2)
+        .Cases("-c", "-MD", "-MMD", 1)
+        .Default(0);
+        
+        if (skip > 0) {
+            index += skip - 1;
+            continue;
+        }
+        
+        // Session of module validation changes on every prebuild, but modules are the same
+        if (arg.startswith("-fbuild-session-timestamp=")) {
+            continue;
+        }
+        
+        if (!arg.startswith("-") && normalizedPath(directory, arg) == source) {
+            continue;
+        }
+        
+        _Flags.push_back(arg);
+    }
+}
+
+bool CompileConfiguration::isModulesEnabled() const {
+    for (auto it = _Flags.rbegin(); it != _Flags.rend(); it++) {
+        if (*it == "-fmodules") {
+            return true;
+        }
+        if (*it == "-fno-modules") {
+            return false;
+        }
+    }
+    
+    return false;
+}
+
+std::string CompileConfiguration::hash() const {
+    llvm::MD5 md5;
+    
+    // Cached modules and PCHs can only be read by the same clang
+    md5.update(clang::getClangFullVersion());
+    md5.update(llvm::StringRef("\0", 1));
+    
+    for (auto &flag : _Flags) {
+        md5.update(flag);
+        md5.update(llvm::StringRef("\0", 1));
+    }
+    
+    llvm::MD5::MD5Result result;
+    md5.final(result);
+    
+    llvm::SmallString<32> digest;
+    llvm::MD5::stringifyResult(result, digest);
+    
+    return digest.str();
+}
+
+std::vector<clang::tooling::CompileCommand> AdjustedCompilationDatabase::getCompileCommands(llvm::StringRef filePath) const {
+    std::vector<clang::tooling::CompileCommand> commands = _Compilations.getCompileCommands(filePath);
+    
+    for (auto &command : commands) {
+        command.CommandLine = _Adjuster(command.CommandLine, command.Directory, filePath);
+    }
+    
+    return commands;
+}
@@ -0,0 +1,64 @@
+#ifndef CompileConfiguration_h
+#define CompileConfiguration_h
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <llvm/ADT/StringRef.h>
+#include <clang/Tooling/CompilationDatabase.h>
+
+/**
+ Compiler flags of a compile command, without the source file and outputs.
+ Files compiled with the same SDK and flags have the same configuration, and share caches built for it.
+ */
+class CompileConfiguration {
+    std::vector<std::string> _Flags;
+
+public:
+    /**
+     commandLine starts with the compiler executable; relative source path in it is resolved from directory.
+     */
+    explicit CompileConfiguration(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath);
+    
+    const std::vector<std::string> &getFlags() const {
+        return _Flags;
+    }
+    
+    /**
+     Returns true if the last of -fmodules and -fno-modules is -fmodules.
+     */
+    bool isModulesEnabled() const;
+    
+    /**
+     Hex digest of clang version and flags, to name cache directories.
+     */
+    std::string hash() const;
+};
+
+/**
+ Compilation database whose command lines are adjusted with the file they compile, to use caches of the configuration.
+ */
+class AdjustedCompilationDatabase : public clang::tooling::CompilationDatabase {
+public:
+    typedef std::function<std::vector<std::string>(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef filePath)> Adjuster;
+    
+    explicit AdjustedCompilationDatabase(const clang::tooling::CompilationDatabase &compilations, Adjuster adjuster)
+    : _Compilations(compilations), _Adjuster(adjuster) {}
+    
+    std::vector<clang::tooling::CompileCommand> getCompileCommands(llvm::StringRef filePath) const override;
+    
+    std::vector<std::string> getAllFiles() const override {
+        return _Compilations.getAllFiles();
+    }
+    
+    std::vector<clang::tooling::CompileCommand> getAllCompileCommands() const override {
+        return _Compilations.getAllCompileCommands();
+    }
+
+private:
+    const clang::tooling::CompilationDatabase &_Compilations;
+    Adjuster _Adjuster;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "ExpressionNullabilityCalculator.h"
+#include "NullabilityFlowAnalysis.h"
+#include "SelectorNullabilityTable.h"
 
 #include <clang/AST/StmtVisitor.h>
 
@@ -6,11 +8,22 @@ using namespace clang;
 
 void VariableNullabilityEnvironment::set(const clang::VarDecl *var, const clang::Type *type, clang::NullabilityKind kind) {
     (*_mapping)[var] = ExpressionNullability(type, kind);
+    _Version++;
+}
+
+const ExpressionNullability *VariableNullabilityEnvironment::find(const clang::VarDecl *var) const {
+    auto it = _mapping->find(var);
+    if (it != _mapping->end()) {
+        return &it->second;
+    }
+    
+    return nullptr;
 }
 
 ExpressionNullability VariableNullabilityEnvironment::lookup(const clang::VarDecl *var) const {
-    if (has(var)) {
-        return _mapping->at(var);
+    const ExpressionNullability *nullability = find(var);
+    if (nullability) {
+        return *nullability;
     } else {
         auto type = var->getType().getTypePtr();
         auto kind = type->getNullability(_ASTContext).getValueOr(NullabilityKind::Unspecified);
@@ -19,19 +32,32 @@ ExpressionNullability VariableNullabilityEnvironment::lookup(const clang::VarDec
 }
 
 bool VariableNullabilityEnvironment::has(const clang::VarDecl *var) const {
-    return _mapping->find(var) != _mapping->end();
+    return find(var) != nullptr;
 }
 
 class ExpressionNullabilityCalculationVisitor : public ConstStmtVisitor<ExpressionNullabilityCalculationVisitor, ExpressionNullability> {
     ASTContext &_ASTContext;
     std::shared_ptr<const VariableNullabilityEnvironment> _VarEnv;
+    ExpressionNullabilityCache &_Cache;
+    const NullabilityFlowAnalysis *_FlowAnalysis;
+    const SelectorNullabilityTable &_SelectorTable;
     
 public:
-    explicit ExpressionNullabilityCalculationVisitor(ASTContext &astContext, std::shared_ptr<const VariableNullabilityEnvironment> varEnv)
-        : _ASTContext(astContext), _VarEnv(varEnv) {}
+    explicit ExpressionNullabilityCalculationVisitor(ASTContext &astContext, std::shared_ptr<const VariableNullabilityEnvironment> varEnv, ExpressionNullabilityCache &cache, const NullabilityFlowAnalysis *flowAnalysis, const SelectorNullabilityTable &selectorTable)
+        : _ASTContext(astContext), _VarEnv(varEnv), _Cache(cache), _FlowAnalysis(flowAnalysis), _SelectorTable(selectorTable) {}
     
     ExpressionNullability recursion(const Expr *expr) {
-        return Visit(expr->IgnoreParenImpCasts());
+        expr = expr->IgnoreParenImpCasts();
+        
+        auto it = _Cache.find(expr);
+        if (it != _Cache.end()) {
+            return it->second;
+        }
+        
+        ExpressionNullability nullability = Visit(expr);
+        _Cache.insert(std::make_pair(expr, nullability));
+        
+        return nullability;
     }
     
     ExpressionNullability VisitExpr(const Expr *expr) {
@@ -63,15 +89,17 @@ public:
     }
     
     ExpressionNullability VisitDeclRefExpr(const DeclRefExpr *ref) {
-        std::string name = ref->getNameInfo().getAsString();
         const Type *type = ref->getType().getTypePtr();
         
-        if (name == "self") {
+        if (isSelfDecl(ref->getDecl())) {
             // Assume self is nonnull
             return ExpressionNullability(type, NullabilityKind::NonNull);
         } else {
             const VarDecl *varDecl = llvm::dyn_cast<VarDecl>(ref->getDecl());
-            if (varDecl && _VarEnv->has(varDecl)) {
+            if (varDecl && _FlowAnalysis && _FlowAnalysis->isNonNull(ref, varDecl)) {
+                // Tested by condition
+                return ExpressionNullability(varDecl->getType().getTypePtr(), NullabilityKind::NonNull);
+            } else if (varDecl && _VarEnv->has(varDecl)) {
                 return _VarEnv->lookup(varDecl);
             } else {
                 return ExpressionNullability(type, type->getNullability(_ASTContext).getValueOr(NullabilityKind::Unspecified));
@@ -85,7 +113,6 @@ public:
     
     ExpressionNullability VisitObjCMessageExpr(const ObjCMessageExpr *messageExpr) {
         const Type *type = messageExpr->getType().getTypePtr();
-        std::string selector = messageExpr->getSelector().getAsString();
 
         auto receiverKind = messageExpr->getReceiverKind();
         
@@ -107,16 +134,7 @@ public:
             
             const Type *retType = messageExpr->getMethodDecl()->getReturnType().getTypePtr();
             
-            NullabilityKind defaultKind = NullabilityKind::Unspecified;
-            
-            std::set<std::string> nonnullMethods;
-            nonnullMethods.insert("class");
-            nonnullMethods.insert("init");
-            nonnullMethods.insert("alloc");
-            
-            if (nonnullMethods.find(selector) != nonnullMethods.end()) {
-                defaultKind = NullabilityKind::NonNull;
-            }
+            NullabilityKind defaultKind = _SelectorTable.lookup(messageExpr);
             
             return ExpressionNullability(retType, retType->getNullability(_ASTContext).getValueOr(defaultKind));
         }
@@ -124,16 +142,7 @@ public:
         if (messageExpr->isClassMessage()) {
             const Type *retType = messageExpr->getMethodDecl()->getReturnType().getTypePtr();
             
-            NullabilityKind defaultKind = NullabilityKind::Unspecified;
-            
-            std::set<std::string> nonnullMethods;
-            nonnullMethods.insert("class");
-            nonnullMethods.insert("alloc");
-            nonnullMethods.insert("new");
-            
-            if (nonnullMethods.find(selector) != nonnullMethods.end()) {
-                defaultKind = NullabilityKind::NonNull;
-            }
+            NullabilityKind defaultKind = _SelectorTable.lookup(messageExpr);
             
             return ExpressionNullability(retType, retType->getNullability(_ASTContext).getValueOr(defaultKind));
         }
@@ -170,11 +179,39 @@ public:
     }
 };
 
+ExpressionNullabilityCalculator::ExpressionNullabilityCalculator(clang::ASTContext &astContext,
+                                                                 std::shared_ptr<VariableNullabilityEnvironment> varEnv,
+                                                                 const NullabilityFlowAnalysis *flowAnalysis,
+                                                                 const SelectorNullabilityTable *selectorTable)
+    : _ASTContext(astContext), _VarEnv(varEnv), _CacheVersion(varEnv->getVersion()), _FlowAnalysis(flowAnalysis), _SelectorTable(selectorTable) {
+    if (!_SelectorTable) {
+        _BuiltinSelectorTable.reset(new SelectorNullabilityTable(astContext, SelectorNullabilityRules()));
+        _SelectorTable = _BuiltinSelectorTable.get();
+    }
+}
+
+ExpressionNullabilityCalculator::~ExpressionNullabilityCalculator() {}
+
 ExpressionNullability ExpressionNullabilityCalculator::calculate(const clang::Expr *expr) {
-    auto visitor = ExpressionNullabilityCalculationVisitor(_ASTContext, _VarEnv);
-    return visitor.Visit(expr->IgnoreParenImpCasts());
+    if (_CacheVersion != _VarEnv->getVersion()) {
+        _Cache.clear();
+        _CacheVersion = _VarEnv->getVersion();
+    }
+    
+    auto visitor = ExpressionNullabilityCalculationVisitor(_ASTContext, _VarEnv, _Cache, _FlowAnalysis, *_SelectorTable);
+    return visitor.recursion(expr);
 }
 
 bool isPointerType(const Type *type) {
     return type->isPointerType() || type->isBlockPointerType() || type->isObjCObjectPointerType() || type->isObjCIdType();
 }
+
+bool isSelfDecl(const Decl *decl) {
+    const ImplicitParamDecl *param = llvm::dyn_cast_or_null<ImplicitParamDecl>(decl);
+    if (!param) {
+        return false;
+    }
+    
+    const ObjCMethodDecl *methodDecl = llvm::dyn_cast<ObjCMethodDecl>(param->getDeclContext());
+    return methodDecl && methodDecl->getSelfDecl() == param;
+}
@@ -1,8 +1,9 @@
 #ifndef ExpressionNullabilityCalculator_h
 #define ExpressionNullabilityCalculator_h
 
-#include <unordered_map>
+#include <memory>
 
+#include <llvm/ADT/DenseMap.h>
 #include <clang/AST/AST.h>
 
 class ExpressionNullability {
@@ -26,47 +27,78 @@ public:
     }
 };
 
-typedef std::unordered_map<const clang::VarDecl *, ExpressionNullability> VariableNullabilityMapping;
+typedef llvm::DenseMap<const clang::VarDecl *, ExpressionNullability> VariableNullabilityMapping;
 
+/**
+ Nullability of variables.
+ */
 class VariableNullabilityEnvironment {
     clang::ASTContext &_ASTContext;
     std::shared_ptr<VariableNullabilityMapping> _mapping;
+    unsigned _Version;
+    
+    const ExpressionNullability *find(const clang::VarDecl *var) const;
     
 public:
     explicit VariableNullabilityEnvironment(clang::ASTContext &astContext, std::shared_ptr<VariableNullabilityMapping> mapping)
-    : _ASTContext(astContext), _mapping(mapping) {}
+    : _ASTContext(astContext), _mapping(mapping), _Version(0) {}
     
     void set(const clang::VarDecl *var, const clang::Type *type, clang::NullabilityKind kind);
     ExpressionNullability lookup(const clang::VarDecl *var) const;
     bool has(const clang::VarDecl *var) const;
     
-    VariableNullabilityEnvironment *newCopy() {
-        auto copy = std::shared_ptr<VariableNullabilityMapping>(new VariableNullabilityMapping);
-        
-        for (auto it : *_mapping) {
-            (*copy)[it.first] = it.second;
-        }
-        
-        return new VariableNullabilityEnvironment(_ASTContext, copy);
+    /**
+     Incremented on every update; results calculated under older version may be obsolete.
+     */
+    unsigned getVersion() const {
+        return _Version;
     }
 };
 
-class ExpressionNullabilityCalculator {
+typedef llvm::DenseMap<const clang::Expr *, ExpressionNullability> ExpressionNullabilityCache;
+
+class NullabilityFlowAnalysis;
+class SelectorNullabilityTable;
+
+class ExpressionNullabilityCalculator final {
     clang::ASTContext &_ASTContext;
     std::shared_ptr<VariableNullabilityEnvironment> _VarEnv;
     
+    /**
+     Results of calculation including subexpressions; valid while the environment stays at _CacheVersion.
+     */
+    ExpressionNullabilityCache _Cache;
+    unsigned _CacheVersion;
+    
+    /**
+     Variables tested to be nonnull by conditions; optional.
+     */
+    const NullabilityFlowAnalysis *_FlowAnalysis;
+    
+    /**
+     Nullability of known selectors; builtin table is used if not given.
+     */
+    const SelectorNullabilityTable *_SelectorTable;
+    std::unique_ptr<SelectorNullabilityTable> _BuiltinSelectorTable;
+    
 public:
-    explicit ExpressionNullabilityCalculator(clang::ASTContext &astContext, std::shared_ptr<VariableNullabilityEnvironment> varEnv)
-        : _ASTContext(astContext), _VarEnv(varEnv) {}
-    virtual ~ExpressionNullabilityCalculator(){};
+    explicit ExpressionNullabilityCalculator(clang::ASTContext &astContext,
+                                             std::shared_ptr<VariableNullabilityEnvironment> varEnv,
+                                             const NullabilityFlowAnalysis *flowAnalysis = nullptr,
+                                             const SelectorNullabilityTable *selectorTable = nullptr);
+    ~ExpressionNullabilityCalculator();
     
-    virtual ExpressionNullability calculate(const clang::Expr *expr);
+    ExpressionNullability calculate(const clang::Expr *expr);
     
-    virtual clang::ASTContext &getASTContext() {
+    clang::ASTContext &getASTContext() {
         return _ASTContext;
     }
 };
 
+/**
+ Infers nullability of variables without explicit nullability from their initializers.
+ propagate(methodDecl) processes whole method body; others update one declaration, so that it can be called while checking the body in source order.
+ */
 class VariableNullabilityPropagation {
     ExpressionNullabilityCalculator &_NullabilityCalculator;
     std::shared_ptr<VariableNullabilityEnvironment> _VarEnv;
@@ -77,7 +109,12 @@ public:
     : _NullabilityCalculator(nullabilityCalculator), _VarEnv(varEnv) {}
     
     void propagate(clang::ObjCMethodDecl *methodDecl);
-    void propagate(clang::BlockExpr *blockExpr);
+    void propagate(const clang::VarDecl *varDecl);
+    
+    /**
+     Elements of for-in loop are nonnull.
+     */
+    void propagate(const clang::ObjCForCollectionStmt *stmt);
 };
 
 /**
@@ -85,4 +122,9 @@ public:
  */
 bool isPointerType(const clang::Type *type);
 
+/**
+ Return true if decl is implicit self parameter of a method.
+ */
+bool isSelfDecl(const clang::Decl *decl);
+
 #endif
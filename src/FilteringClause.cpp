@@ -4,26 +4,92 @@ bool TextFilteringClause::testClassName(const std::set<std::string> &subjects) {
     return subjects.find(_Text) != subjects.end();
 }
 
+void TextFilteringClause::compile(Filter &filter) const {
+    filter.addClassName(_Text);
+}
+
 bool RegexpFilteringClause::testClassName(const std::set<std::string> &subjects) {
-    for (auto subject : subjects) {
-        std::smatch m;
-        if (std::regex_search(subject, m, _Regexp)) {
+    for (auto &subject : subjects) {
+        if (_Regexp.match(subject)) {
             return true;
         }
     }
     return false;
 }
 
+void RegexpFilteringClause::compile(Filter &filter) const {
+    filter.addPattern(_Pattern);
+}
+
+void Filter::addClassName(llvm::StringRef name) {
+    _Names.insert(name);
+    _Verdicts.clear();
+}
+
+void Filter::addPattern(llvm::StringRef pattern) {
+    _Patterns.push_back(pattern.str());
+    
+    // Compiled on first test, once for all of the patterns
+    _Regexp.reset();
+    _Verdicts.clear();
+}
+
+void Filter::compilePatterns() {
+    std::string combined;
+    for (auto &p : _Patterns) {
+        if (!combined.empty()) {
+            combined += "|";
+        }
+        combined += "(" + p + ")";
+    }
+    
+    _Regexp.reset(new llvm::Regex(combined));
+}
+
+bool Filter::matchClassName(llvm::StringRef name) {
+    if (_Names.count(name)) {
+        return true;
+    }
+    
+    if (_Patterns.empty()) {
+        return false;
+    }
+    
+    if (!_Regexp) {
+        compilePatterns();
+    }
+    
+    return _Regexp->match(name);
+}
+
+bool Filter::testClassName(llvm::StringRef name) {
+    if (isEmpty()) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> lock(_VerdictsMutex);
+    
+    auto it = _Verdicts.find(name);
+    if (it != _Verdicts.end()) {
+        return it->second;
+    }
+    
+    bool verdict = matchClassName(name);
+    _Verdicts[name] = verdict;
+    
+    return verdict;
+}
+
 bool Filter::testClassName(const std::set<std::string> &subjects) {
-    if (_Clauses.empty()) {
+    if (isEmpty()) {
         return true;
-    } else {
-        for (auto clause : _Clauses) {
-            if (clause->testClassName(subjects)) {
-                return true;
-            }
+    }
+    
+    for (auto &subject : subjects) {
+        if (testClassName(llvm::StringRef(subject))) {
+            return true;
         }
-        
-        return false;
     }
-}
\ No newline at end of file
+    
+    return false;
+}
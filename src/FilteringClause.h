@@ -2,13 +2,28 @@
 #define FilteringClause_h
 
 #include <string>
-#include <regex>
+#include <set>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringSet.h>
+#include <llvm/Support/Regex.h>
+
+class Filter;
 
 class FilteringClause {
 public:
     virtual bool testClassName(const std::set<std::string> &subjects) {
         return false;
     }
+    
+    /**
+     Adds the clause to compiled form of filter.
+     */
+    virtual void compile(Filter &filter) const = 0;
+    
     virtual ~FilteringClause() {};
 };
 
@@ -19,24 +34,60 @@ public:
     TextFilteringClause(std::string text) : _Text(text) {};
     
     bool testClassName(const std::set<std::string> &subjects) override;
+    void compile(Filter &filter) const override;
 };
 
+/**
+ Clause with POSIX extended regular expression, which matches if any part of class name matches.
+ */
 class RegexpFilteringClause : public FilteringClause {
-    std::regex _Regexp;
+    std::string _Pattern;
+    llvm::Regex _Regexp;
+    
 public:
-    RegexpFilteringClause(std::regex regexp) : _Regexp(regexp) {};
+    RegexpFilteringClause(std::string pattern) : _Pattern(pattern), _Regexp(pattern) {};
+    
+    bool isValid(std::string &error) {
+        return _Regexp.isValid(error);
+    }
     
     bool testClassName(const std::set<std::string> &subjects) override;
+    void compile(Filter &filter) const override;
 };
 
+/**
+ Clauses are compiled to a set of class names and one regexp which combines all of regexp clauses.
+ Verdicts are memoized per class name, so that each class name is matched once.
+ Testing is thread safe, so that one filter can be shared by translation units analyzed in parallel.
+ Clauses should be added before testing.
+ */
 class Filter {
-    std::vector<std::shared_ptr<FilteringClause>> _Clauses;
+    llvm::StringSet<> _Names;
+    std::vector<std::string> _Patterns;
+    std::unique_ptr<llvm::Regex> _Regexp;
+    llvm::StringMap<bool> _Verdicts;
+    std::mutex _VerdictsMutex;
+    
+    void compilePatterns();
+    
+    /**
+     Called with _VerdictsMutex locked; the regexp is compiled on the first call.
+     */
+    bool matchClassName(llvm::StringRef name);
     
 public:
     void addClause(std::shared_ptr<FilteringClause> clause) {
-        _Clauses.push_back(clause);
+        clause->compile(*this);
+    }
+    
+    void addClassName(llvm::StringRef name);
+    void addPattern(llvm::StringRef pattern);
+    
+    bool isEmpty() const {
+        return _Names.empty() && _Patterns.empty();
     }
     
+    bool testClassName(llvm::StringRef name);
     bool testClassName(const std::set<std::string> &subjects);
 };
 
@@ -1,77 +1,65 @@
+#include <llvm/ADT/SmallBitVector.h>
+
 #include "InitializerChecker.h"
+#include "ExpressionNullabilityCalculator.h"
 
 using namespace clang;
 using namespace std;
 
-weak_ptr<IvarInfo> findIvarInfo(set<shared_ptr<IvarInfo>> &set, const ObjCIvarDecl *ivarDecl) {
-    weak_ptr<IvarInfo> result;
-    
-    if (ivarDecl) {
-        for (auto &info : set) {
-            if (info->getIvarDecl() == ivarDecl) {
-                result = weak_ptr<IvarInfo>(info);
-                break;
-            }
-        }
+bool InitializerMethodCache::isInitializerMethod(const clang::ObjCMethodDecl *methodDecl) {
+    if (!methodDecl) {
+        return false;
     }
     
-    return result;
-}
-
-weak_ptr<IvarInfo> findIvarInfo(set<shared_ptr<IvarInfo>> &set, const ObjCMethodDecl *setterMethod) {
-    weak_ptr<IvarInfo> result;
-    
-    if (setterMethod) {
-        for (auto &info : set) {
-            auto propDecl = info->getPropertyDecl();
-            if (propDecl && propDecl->getSetterMethodDecl() == setterMethod) {
-                result = weak_ptr<IvarInfo>(info);
-                break;
-            }
-        }
+    auto it = _Cache.find(methodDecl);
+    if (it != _Cache.end()) {
+        return it->second;
     }
     
-    return result;
-}
-
-bool isInitializerMethod(clang::ObjCMethodDecl *methodDecl) {
-    for (auto attr : methodDecl->attrs()) {
-        auto annot = llvm::dyn_cast<AnnotateAttr>(attr);
-        if (annot) {
-            std::string annotation = annot->getAnnotation();
-            if (annotation == "nlh_initializer") {
-                return true;
-            }
+    bool result = false;
+    for (auto annot : methodDecl->specific_attrs<AnnotateAttr>()) {
+        if (annot->getAnnotation() == "nlh_initializer") {
+            result = true;
+            break;
         }
     }
     
-    return false;
+    _Cache[methodDecl] = result;
+    return result;
 }
 
 class InitializerCheckerImpl : public RecursiveASTVisitor<InitializerCheckerImpl> {
     clang::ASTContext &_ASTContext;
     ObjCMethodDecl *_MethodDecl;
-    set<shared_ptr<IvarInfo>> &_NonnullIvars;
+    const llvm::DenseMap<const Decl *, unsigned> &_Indices;
+    InitializerMethodCache &_InitializerMethods;
+    llvm::SmallBitVector &_Uninitialized;
+    
+    void markInitialized(const Decl *decl) {
+        if (decl) {
+            auto it = _Indices.find(decl);
+            if (it != _Indices.end()) {
+                _Uninitialized.reset(it->second);
+            }
+        }
+    }
     
 public:
-    InitializerCheckerImpl(clang::ASTContext &astContext, ObjCMethodDecl *methodDecl, set<shared_ptr<IvarInfo>> &nonnullIvars)
-    : _ASTContext(astContext), _MethodDecl(methodDecl), _NonnullIvars(nonnullIvars) {}
+    InitializerCheckerImpl(clang::ASTContext &astContext, ObjCMethodDecl *methodDecl, const llvm::DenseMap<const Decl *, unsigned> &indices, InitializerMethodCache &initializerMethods, llvm::SmallBitVector &uninitialized)
+    : _ASTContext(astContext), _MethodDecl(methodDecl), _Indices(indices), _InitializerMethods(initializerMethods), _Uninitialized(uninitialized) {}
     
     bool VisitObjCMessageExpr(ObjCMessageExpr *messageExpr) {
         ObjCMethodDecl *decl = messageExpr->getMethodDecl();
-        auto info = findIvarInfo(_NonnullIvars, decl);
-        if (!info.expired()) {
-            _NonnullIvars.erase(info.lock());
-        }
+        markInitialized(decl);
         
-        if (isInitializerMethod(decl)) {
+        if (_InitializerMethods.isInitializerMethod(decl)) {
             auto receiver = messageExpr->getInstanceReceiver();
             if (receiver) {
                 auto varRef = llvm::dyn_cast<DeclRefExpr>(receiver->IgnoreParenImpCasts());
                 
                 if (varRef) {
-                    if (varRef->getDecl()->getNameAsString() == "self" && decl->getClassInterface() == _MethodDecl->getClassInterface()) {
-                        _NonnullIvars.clear();
+                    if (isSelfDecl(varRef->getDecl()) && decl->getClassInterface() == _MethodDecl->getClassInterface()) {
+                        _Uninitialized.reset();
                     }
                 }
             }
@@ -85,7 +73,7 @@ public:
         TraverseStmt(cond);
         
         auto condVar = llvm::dyn_cast<DeclRefExpr>(cond->IgnoreParenImpCasts());
-        if (condVar && condVar->getDecl()->getNameAsString() == "self" && !ifstmt->getElse()) {
+        if (condVar && isSelfDecl(condVar->getDecl()) && !ifstmt->getElse()) {
             // if (self) {
             //   // do some initialization
             // }
@@ -107,88 +95,95 @@ public:
     bool VisitBinAssign(BinaryOperator *expr) {
         ObjCIvarRefExpr *ivarRef = llvm::dyn_cast<ObjCIvarRefExpr>(expr->getLHS()->IgnoreParenImpCasts());
         if (ivarRef) {
-            ObjCIvarDecl *ivarDecl = ivarRef->getDecl();
-            auto info = findIvarInfo(_NonnullIvars, ivarDecl);
-            if (!info.expired()) {
-                _NonnullIvars.erase(info.lock());
-            }
+            markInitialized(ivarRef->getDecl());
         }
         return true;
     }
     
-    set<shared_ptr<IvarInfo>> &getNonnullIvars() {
-        return _NonnullIvars;
-    }
-    
     void processBranch(Stmt *branch1, Stmt *branch2) {
-        set<shared_ptr<IvarInfo>> branchVars1 = _NonnullIvars;
-        auto branchChecker1 = InitializerCheckerImpl(_ASTContext, _MethodDecl, branchVars1);
+        llvm::SmallBitVector branchVars1 = _Uninitialized;
         if (branch1) {
-            branchChecker1.TraverseStmt(branch1);
+            InitializerCheckerImpl(_ASTContext, _MethodDecl, _Indices, _InitializerMethods, branchVars1).TraverseStmt(branch1);
         }
         
-        set<shared_ptr<IvarInfo>> branchVars2 = _NonnullIvars;
-        auto branchChecker2 = InitializerCheckerImpl(_ASTContext, _MethodDecl, branchVars2);
+        llvm::SmallBitVector branchVars2 = _Uninitialized;
         if (branch2) {
-            branchChecker2.TraverseStmt(branch2);
+            InitializerCheckerImpl(_ASTContext, _MethodDecl, _Indices, _InitializerMethods, branchVars2).TraverseStmt(branch2);
         }
         
-        set<shared_ptr<IvarInfo>> postVars;
-        set_union(branchVars1.begin(), branchVars1.end(), branchVars2.begin(), branchVars2.end(), inserter(postVars, postVars.end()));
-        
-        set<shared_ptr<IvarInfo>> intersection;
-        set_intersection(postVars.begin(), postVars.end(), _NonnullIvars.begin(), _NonnullIvars.end(), inserter(intersection, intersection.end()));
-        
-        _NonnullIvars.clear();
-        _NonnullIvars.insert(intersection.begin(), intersection.end());
+        // Ivar is initialized after the branch only if it is initialized in both branches
+        _Uninitialized = branchVars1;
+        _Uninitialized |= branchVars2;
     }
 };
 
-std::set<shared_ptr<IvarInfo>> InitializerChecker::getNonnullIvars() {
-    std::set<shared_ptr<IvarInfo>> set;
+void InitializerChecker::buildIvarTable() {
+    if (_IvarTableBuilt) {
+        return;
+    }
+    _IvarTableBuilt = true;
     
     for (auto ivarDecl : _ImplementationDecl->ivars()) {
         const Type *type = ivarDecl->getType().getTypePtrOrNull();
         if (type) {
             if (type->getNullability(_ASTContext).getValueOr(NullabilityKind::Unspecified) == NullabilityKind::NonNull) {
-                set.insert(std::shared_ptr<IvarInfo>{ new IvarInfo(ivarDecl) });
+                _Indices[ivarDecl] = _NonnullIvars.size();
+                _NonnullIvars.push_back(IvarInfo(ivarDecl));
             }
         }
     }
     
     auto interfaceDecl = _ImplementationDecl->getClassInterface();
     
-    for (auto propDecl : interfaceDecl->properties()) {
-        weak_ptr<IvarInfo> ivarInfo = findIvarInfo(set, propDecl->getPropertyIvarDecl());
-        if (!ivarInfo.expired()) {
-            auto shared = ivarInfo.lock();
-            shared->setPropertyDecl(propDecl);
+    auto addProperty = [&](const ObjCPropertyDecl *propDecl) {
+        const ObjCIvarDecl *ivarDecl = propDecl->getPropertyIvarDecl();
+        if (!ivarDecl) {
+            return;
         }
+        
+        auto it = _Indices.find(ivarDecl);
+        if (it != _Indices.end()) {
+            unsigned index = it->second;
+            _NonnullIvars[index].setPropertyDecl(propDecl);
+            if (const ObjCMethodDecl *setter = propDecl->getSetterMethodDecl()) {
+                _Indices[setter] = index;
+            }
+        }
+    };
+    
+    for (auto propDecl : interfaceDecl->properties()) {
+        addProperty(propDecl);
     }
     
     for (auto extensionDecl : interfaceDecl->visible_extensions()) {
         for (auto propDecl : extensionDecl->properties()) {
-            weak_ptr<IvarInfo> ivarInfo = findIvarInfo(set, propDecl->getPropertyIvarDecl());
-            if (!ivarInfo.expired()) {
-                auto shared = ivarInfo.lock();
-                shared->setPropertyDecl(propDecl);
-            }
+            addProperty(propDecl);
         }
     }
-    
-    return set;
 }
 
-set<shared_ptr<IvarInfo>> InitializerChecker::check(clang::ObjCMethodDecl *methodDecl) {
-    if (!isInitializerMethod(methodDecl)) {
-        return set<shared_ptr<IvarInfo>>();
+const std::vector<IvarInfo> &InitializerChecker::getNonnullIvars() {
+    buildIvarTable();
+    return _NonnullIvars;
+}
+
+std::vector<const IvarInfo *> InitializerChecker::check(clang::ObjCMethodDecl *methodDecl) {
+    std::vector<const IvarInfo *> uninitializedIvars;
+    
+    if (!_InitializerMethods.isInitializerMethod(methodDecl)) {
+        return uninitializedIvars;
     }
     
-    auto nonnullIvars = _NonnullIvars;
+    buildIvarTable();
     
-    InitializerCheckerImpl impl(_ASTContext, methodDecl, nonnullIvars);
+    llvm::SmallBitVector uninitialized(_NonnullIvars.size(), true);
+    
+    InitializerCheckerImpl impl(_ASTContext, methodDecl, _Indices, _InitializerMethods, uninitialized);
     impl.TraverseStmt(methodDecl->getBody());
     
-    return nonnullIvars;
+    for (int index = uninitialized.find_first(); index >= 0; index = uninitialized.find_next(index)) {
+        uninitializedIvars.push_back(&_NonnullIvars[index]);
+    }
+    
+    return uninitializedIvars;
 }
-
@@ -1,9 +1,9 @@
 #ifndef InitializerChecker_h
 #define InitializerChecker_h
 
-#include <unordered_map>
-#include <set>
+#include <vector>
 
+#include <llvm/ADT/DenseMap.h>
 #include <clang/AST/AST.h>
 
 class IvarInfo {
@@ -12,11 +12,11 @@ class IvarInfo {
 public:
     IvarInfo(const clang::ObjCIvarDecl *ivarDecl) : _IvarDecl(ivarDecl), _PropertyDecl(nullptr) {}
     
-    const clang::ObjCIvarDecl *getIvarDecl() {
+    const clang::ObjCIvarDecl *getIvarDecl() const {
         return _IvarDecl;
     }
     
-    const clang::ObjCPropertyDecl *getPropertyDecl() {
+    const clang::ObjCPropertyDecl *getPropertyDecl() const {
         return _PropertyDecl;
     }
     
@@ -25,19 +25,38 @@ public:
     }
 };
 
+/**
+ Memoizes if methods are annotated as initializer with `__attribute__((annotate("nlh_initializer")))`.
+ */
+class InitializerMethodCache {
+    llvm::DenseMap<const clang::ObjCMethodDecl *, bool> _Cache;
+    
+public:
+    bool isInitializerMethod(const clang::ObjCMethodDecl *methodDecl);
+};
+
+/**
+ Checks if initializers assign all nonnull ivars.
+ Each nonnull ivar has a dense index, and uninitialized ivars are tracked as a bitvector over the indices.
+ The ivar table is built on first check of an initializer.
+ */
 class InitializerChecker {
     clang::ASTContext &_ASTContext;
     const clang::ObjCImplementationDecl *_ImplementationDecl;
-    std::set<std::shared_ptr<IvarInfo>> _NonnullIvars;
+    InitializerMethodCache &_InitializerMethods;
+    bool _IvarTableBuilt;
+    std::vector<IvarInfo> _NonnullIvars;
+    /** Index of nonnull ivar, from ivar and from setter of its property */
+    llvm::DenseMap<const clang::Decl *, unsigned> _Indices;
+    
+    void buildIvarTable();
     
 public:
-    InitializerChecker(clang::ASTContext &astContext, const clang::ObjCImplementationDecl *implementationDecl)
-    : _ASTContext(astContext), _ImplementationDecl(implementationDecl) {
-        _NonnullIvars = getNonnullIvars();
-    }
+    InitializerChecker(clang::ASTContext &astContext, const clang::ObjCImplementationDecl *implementationDecl, InitializerMethodCache &initializerMethods)
+    : _ASTContext(astContext), _ImplementationDecl(implementationDecl), _InitializerMethods(initializerMethods), _IvarTableBuilt(false) {}
     
-    std::set<std::shared_ptr<IvarInfo>> check(clang::ObjCMethodDecl *methodDecl);
-    std::set<std::shared_ptr<IvarInfo>> getNonnullIvars();
+    std::vector<const IvarInfo *> check(clang::ObjCMethodDecl *methodDecl);
+    const std::vector<IvarInfo> &getNonnullIvars();
 };
 
 #endif /* InitializerChecker_hpp */
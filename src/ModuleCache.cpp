@@ -0,0 +1,298 @@
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Regex.h>
+#include <llvm/Support/raw_ostream.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/VirtualFileSystem.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Lex/HeaderMap.h>
+#include <clang/Tooling/Tooling.h>
+
+#include "ModuleCache.h"
+
+using namespace clang;
+using namespace clang::tooling;
+
+std::string ModuleCache::defaultRootPath() {
+    llvm::SmallString<256> path;
+    llvm::sys::path::system_temp_directory(true, path);
+    llvm::sys::path::append(path, "nullarihyon-modules");
+    
+    return path.str();
+}
+
+std::string ModuleCache::cachePath(const CompileConfiguration &configuration) const {
+    llvm::SmallString<256> path(_RootPath);
+    llvm::sys::path::append(path, configuration.hash());
+    
+    return path.str();
+}
+
+std::string ModuleCache::stampPath(const CompileConfiguration &configuration) const {
+    llvm::SmallString<256> path(cachePath(configuration));
+    llvm::sys::path::append(path, "prebuilt");
+    
+    return path.str();
+}
+
+void ModuleCache::collectImports(llvm::StringRef source, std::set<std::string> &headers, std::set<std::string> &modules, std::set<std::string> *quotedHeaders) {
+    llvm::Regex headerImport("^[ \t]*#[ \t]*(import|include)[ \t]*<([^>]+)>");
+    llvm::Regex quotedImport("^[ \t]*#[ \t]*(import|include)[ \t]*\"([^\"]+)\"");
+    llvm::Regex moduleImport("^[ \t]*@import[ \t]+([A-Za-z0-9_.]+)[ \t]*;");
+    
+    llvm::SmallVector<llvm::StringRef, 256> lines;
+    source.split(lines, "\n");
+    
+    for (auto line : lines) {
+        llvm::SmallVector<llvm::StringRef, 3> matches;
+        
+        if (headerImport.match(line, &matches)) {
+            headers.insert(matches[2]);
+        } else if (moduleImport.match(line, &matches)) {
+            modules.insert(matches[1]);
+        } else if (quotedHeaders && quotedImport.match(line, &matches)) {
+            quotedHeaders->insert(matches[2]);
+        }
+    }
+}
+
+std::vector<std::string> ModuleCache::quotedSearchPaths(const std::vector<std::string> &commandLine, llvm::StringRef directory) {
+    std::vector<std::string> paths;
+    
+    auto addPath = [&](llvm::StringRef path) {
+        llvm::SmallString<256> result;
+        if (!llvm::sys::path::is_absolute(path)) {
+            result = directory;
+        }
+        llvm::sys::path::append(result, path);
+        paths.push_back(result.str());
+    };
+    
+    for (size_t index = 0; index < commandLine.size(); index++) {
+        llvm::StringRef arg = commandLine[index];
+        
+        if ((arg == "-iquote" || arg == "-I") && index + 1 < commandLine.size()) {
+            addPath(commandLine[++index]);
+        } else if (arg.startswith("-iquote")) {
+            addPath(arg.substr(strlen("-iquote")));
+        } else if (arg.startswith("-I")) {
+            addPath(arg.substr(strlen("-I")));
+        }
+    }
+    
+    return paths;
+}
+
+void ModuleCache::collectFileImports(llvm::StringRef path, const std::vector<std::string> &searchPaths, std::set<std::string> &headers, std::set<std::string> &modules) {
+    FileManager files((FileSystemOptions()));
+    
+    // Xcode gives project headers by header maps
+    struct SearchPath {
+        std::string Directory;
+        std::unique_ptr<const HeaderMap> Map;
+    };
+    std::vector<SearchPath> searchEntries;
+    for (auto &searchPath : searchPaths) {
+        std::unique_ptr<const HeaderMap> map;
+        if (llvm::sys::path::extension(searchPath) == ".hmap") {
+            if (const FileEntry *entry = files.getFile(searchPath)) {
+                map.reset(HeaderMap::Create(entry, files));
+            }
+        }
+        searchEntries.push_back(SearchPath{ searchPath, std::move(map) });
+    }
+    
+    auto findHeader = [&](llvm::StringRef name, const FileEntry *includer) -> const FileEntry * {
+        llvm::SmallString<256> path(includer->getDir()->getName());
+        llvm::sys::path::append(path, name);
+        if (const FileEntry *entry = files.getFile(path)) {
+            return entry;
+        }
+        
+        for (auto &searchEntry : searchEntries) {
+            if (searchEntry.Map) {
+                if (const FileEntry *entry = searchEntry.Map->LookupFile(name, files)) {
+                    return entry;
+                }
+            } else {
+                path = searchEntry.Directory;
+                llvm::sys::path::append(path, name);
+                if (const FileEntry *entry = files.getFile(path)) {
+                    return entry;
+                }
+            }
+        }
+        
+        return nullptr;
+    };
+    
+    std::set<const FileEntry *> visited;
+    std::vector<const FileEntry *> queue;
+    if (const FileEntry *entry = files.getFile(path)) {
+        queue.push_back(entry);
+    }
+    
+    while (!queue.empty()) {
+        const FileEntry *entry = queue.back();
+        queue.pop_back();
+        
+        if (!visited.insert(entry).second) {
+            continue;
+        }
+        
+        auto buffer = files.getBufferForFile(entry);
+        if (!buffer) {
+            continue;
+        }
+        
+        std::set<std::string> quotedHeaders;
+        collectImports((*buffer)->getBuffer(), headers, modules, &quotedHeaders);
+        
+        for (auto &name : quotedHeaders) {
+            if (const FileEntry *header = findHeader(name, entry)) {
+                queue.push_back(header);
+            }
+        }
+    }
+}
+
+std::string ModuleCache::importSource(const std::set<std::string> &headers, const std::set<std::string> &modules) {
+    std::string source;
+    llvm::raw_string_ostream os(source);
+    
+    // Missing header is a fatal error, which stops following imports
+    for (auto &header : headers) {
+        os << "#if __has_include(<" << header << ">)\n";
+        os << "#import <" << header << ">\n";
+        os << "#endif\n";
+    }
+    
+    for (auto &module : modules) {
+        os << "@import " << module << ";\n";
+    }
+    
+    return os.str();
+}
+
+bool ModuleCache::prebuild(const CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths) {
+    struct Prebuild {
+        CompileConfiguration Configuration;
+        std::string Directory;
+        std::set<std::string> Headers;
+        std::set<std::string> Modules;
+    };
+    
+    // Configurations in order of their first files
+    std::vector<Prebuild> prebuilds;
+    std::map<std::string, size_t> indices;
+    
+    for (auto &path : sourcePaths) {
+        llvm::SmallString<256> absolutePath(path);
+        llvm::sys::fs::make_absolute(absolutePath);
+        
+        for (auto &command : compilations.getCompileCommands(absolutePath)) {
+            CompileConfiguration configuration(command.CommandLine, command.Directory, absolutePath);
+            if (!configuration.isModulesEnabled()) {
+                continue;
+            }
+            
+            std::string hash = configuration.hash();
+            if (indices.find(hash) == indices.end()) {
+                indices[hash] = prebuilds.size();
+                prebuilds.push_back(Prebuild{ configuration, command.Directory, {}, {} });
+            }
+            
+            // Modules may be imported only by project headers
+            Prebuild &prebuild = prebuilds[indices[hash]];
+            collectFileImports(absolutePath, quotedSearchPaths(command.CommandLine, command.Directory), prebuild.Headers, prebuild.Modules);
+        }
+    }
+    
+    // Resource directory is found relative to the executable
+    static int StaticSymbol;
+    std::string mainExecutable = llvm::sys::fs::getMainExecutable("nullarihyon-core", &StaticSymbol);
+    
+    // Source paths given later are resolved from the initial directory
+    IntrusiveRefCntPtr<vfs::FileSystem> realFileSystem = vfs::getRealFileSystem();
+    llvm::ErrorOr<std::string> initialDirectory = realFileSystem->getCurrentWorkingDirectory();
+    
+    bool success = true;
+    
+    for (auto &prebuild : prebuilds) {
+        std::string modulesPath = cachePath(prebuild.Configuration);
+        if (llvm::sys::fs::create_directories(modulesPath)) {
+            success = false;
+            continue;
+        }
+        
+        // Clang compares validation times of modules with the session in seconds, and trusts only strictly newer ones;
+        // the session starts a second before the run, so that modules validated by the run are newer than it
+        llvm::sys::TimeValue session = llvm::sys::TimeValue::now() - llvm::sys::TimeValue(1, 0);
+        
+        llvm::SmallString<256> sourcePath(modulesPath);
+        llvm::sys::path::append(sourcePath, "prebuild.m");
+        std::string source = importSource(prebuild.Headers, prebuild.Modules);
+        
+        std::vector<std::string> commandLine{ mainExecutable };
+        commandLine.insert(commandLine.end(), prebuild.Configuration.getFlags().begin(), prebuild.Configuration.getFlags().end());
+        commandLine.push_back("-fsyntax-only");
+        commandLine.push_back("-fmodules-cache-path=" + modulesPath);
+        commandLine.push_back("-fmodules-validate-once-per-build-session");
+        commandLine.push_back("-fbuild-session-timestamp=" + std::to_string(session.toEpochTime()));
+        commandLine.push_back(sourcePath.str());
+        
+        // Relative header search paths are resolved from the directory of the compile command
+        realFileSystem->setCurrentWorkingDirectory(prebuild.Directory);
+        
+        IntrusiveRefCntPtr<FileManager> files(new FileManager(FileSystemOptions()));
+        ToolInvocation invocation(std::move(commandLine), new PreprocessOnlyAction, files.get());
+        invocation.mapVirtualFile(sourcePath, source);
+        
+        // Errors in non-modular headers are not interesting here; analyses report them
+        IgnoringDiagConsumer diagnosticConsumer;
+        invocation.setDiagnosticConsumer(&diagnosticConsumer);
+        
+        // Stamp is written when modules are built; without it analyses validate modules by themselves
+        if (invocation.run()) {
+            int fd;
+            if (!llvm::sys::fs::openFileForWrite(stampPath(prebuild.Configuration), fd, llvm::sys::fs::F_None)) {
+                llvm::sys::fs::setLastModificationAndAccessTime(fd, session);
+                llvm::raw_fd_ostream stamp(fd, true);
+            }
+        } else {
+            llvm::sys::fs::remove(stampPath(prebuild.Configuration));
+            success = false;
+        }
+    }
+    
+    if (initialDirectory) {
+        realFileSystem->setCurrentWorkingDirectory(*initialDirectory);
+    }
+    
+    return success;
+}
+
+std::vector<std::string> ModuleCache::adjustCommandLine(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath) const {
+    CompileConfiguration configuration(commandLine, directory, sourcePath);
+    if (!configuration.isModulesEnabled()) {
+        return commandLine;
+    }
+    
+    std::vector<std::string> result = commandLine;
+    result.push_back("-fmodules-cache-path=" + cachePath(configuration));
+    
+    llvm::sys::fs::file_status stamp;
+    if (!llvm::sys::fs::status(stampPath(configuration), stamp)) {
+        uint64_t timestamp = stamp.getLastModificationTime().toEpochTime();
+        result.push_back("-fmodules-validate-once-per-build-session");
+        result.push_back("-fbuild-session-timestamp=" + std::to_string(timestamp));
+    }
+    
+    return result;
+}
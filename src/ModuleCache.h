@@ -0,0 +1,68 @@
+#ifndef ModuleCache_h
+#define ModuleCache_h
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include "CompileConfiguration.h"
+
+/**
+ Implicit modules shared by analyses, in directories keyed by hash of compile configuration.
+ Modules are built once by prebuild, before analyses start; analyses read them without validating again,
+ so that they do not build modules or wait for lock files of modules being built by other analyses.
+ */
+class ModuleCache {
+    std::string _RootPath;
+    
+    std::string stampPath(const CompileConfiguration &configuration) const;
+
+public:
+    explicit ModuleCache(llvm::StringRef rootPath) : _RootPath(rootPath) {}
+    
+    /**
+     Default root: nullarihyon-modules in the temporary directory of the user.
+     */
+    static std::string defaultRootPath();
+    
+    std::string cachePath(const CompileConfiguration &configuration) const;
+    
+    /**
+     Builds modules imported by the files, with one preprocessor run for each configuration.
+     Returns false if the preprocessor fails; analyses still work, and build modules they need.
+     */
+    bool prebuild(const clang::tooling::CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths);
+    
+    /**
+     Points command line to the cache of its configuration, if modules are enabled.
+     Modules are not validated again if they are validated by the last prebuild.
+     */
+    std::vector<std::string> adjustCommandLine(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath) const;
+    
+    /**
+     Collects headers imported with angle brackets and modules imported with @import.
+     Names of headers included with quotes are collected to quotedHeaders, if given.
+     */
+    static void collectImports(llvm::StringRef source, std::set<std::string> &headers, std::set<std::string> &modules, std::set<std::string> *quotedHeaders = nullptr);
+    
+    /**
+     Collects imports of the file, and of project headers it includes with quotes, transitively.
+     Quoted headers are found next to the including file, then in searchPaths (directories and header maps).
+     */
+    static void collectFileImports(llvm::StringRef path, const std::vector<std::string> &searchPaths, std::set<std::string> &headers, std::set<std::string> &modules);
+    
+    /**
+     Paths of -iquote and -I options in command line, resolved from directory.
+     */
+    static std::vector<std::string> quotedSearchPaths(const std::vector<std::string> &commandLine, llvm::StringRef directory);
+    
+    /**
+     Source which imports the headers and modules; missing headers are skipped.
+     */
+    static std::string importSource(const std::set<std::string> &headers, const std::set<std::string> &modules);
+};
+
+#endif
@@ -1,23 +1,24 @@
+#include <llvm/ADT/SmallPtrSet.h>
+
 #include "NullabilityDependencyCalculator.h"
 
 using namespace clang;
 
-class VariableReferenceExpander : public RecursiveASTVisitor<VariableReferenceExpander> {
-    std::set<const Expr *> &_Set;
-    const VarDecl *_Decl;
+class VariableDefinitionCollector : public RecursiveASTVisitor<VariableDefinitionCollector> {
+    llvm::DenseMap<const VarDecl *, llvm::SmallVector<const Expr *, 2>> &_Definitions;
     
 public:
     
-    explicit VariableReferenceExpander(const VarDecl *decl, std::set<const Expr *> &set) : _Set(set), _Decl(decl) {}
+    explicit VariableDefinitionCollector(llvm::DenseMap<const VarDecl *, llvm::SmallVector<const Expr *, 2>> &definitions) : _Definitions(definitions) {}
     
     bool VisitDeclStmt(const DeclStmt *declStmt) {
         for (auto decl : declStmt->getDeclGroup()) {
-            if (decl == _Decl) {
-                auto varDecl = llvm::dyn_cast<VarDecl>(decl);
+            auto varDecl = llvm::dyn_cast<VarDecl>(decl);
+            if (varDecl) {
                 const Expr *init = varDecl->getInit();
                 
                 if (init && !llvm::isa<ImplicitValueInitExpr>(init)) {
-                    _Set.insert(init->IgnoreParenImpCasts());
+                    _Definitions[varDecl].push_back(init->IgnoreParenImpCasts());
                 }
             }
         }
@@ -27,102 +28,162 @@ public:
     
     bool VisitBinAssign(const BinaryOperator *assign) {
         DeclRefExpr *lhs = llvm::dyn_cast<DeclRefExpr>(assign->getLHS());
-        if (lhs && lhs->getDecl() == _Decl) {
-            _Set.insert(assign->getRHS()->IgnoreParenImpCasts());
+        if (lhs) {
+            const VarDecl *varDecl = llvm::dyn_cast<VarDecl>(lhs->getDecl());
+            if (varDecl) {
+                _Definitions[varDecl].push_back(assign->getRHS()->IgnoreParenImpCasts());
+            }
         }
         return true;
     }
 };
 
-std::set<const clang::Expr *> NullabilityDependencyExpandVisitor::VisitExpr(const clang::Expr *expr) {
-    std::set<const Expr *> set;
+VariableDefinitionIndex::VariableDefinitionIndex(const clang::ObjCMethodDecl *methodDecl) {
+    VariableDefinitionCollector collector(_Definitions);
+    collector.TraverseStmt(methodDecl->getBody());
+}
+
+llvm::ArrayRef<const clang::Expr *> VariableDefinitionIndex::lookup(const clang::VarDecl *varDecl) const {
+    auto it = _Definitions.find(varDecl);
+    if (it != _Definitions.end()) {
+        return it->second;
+    } else {
+        return llvm::None;
+    }
+}
+
+NullabilityDependencyList NullabilityDependencyExpandVisitor::VisitExpr(const clang::Expr *expr) {
+    NullabilityDependencyList list;
     
     const ExprWithCleanups *exprWithCleanups = llvm::dyn_cast<ExprWithCleanups>(expr);
     if (exprWithCleanups) {
-        set.insert(exprWithCleanups->getSubExpr());
-        return set;
+        list.push_back(exprWithCleanups->getSubExpr());
+        return list;
     }
     
     if (const PseudoObjectExpr *pseudoObjectExpr = llvm::dyn_cast<PseudoObjectExpr>(expr)) {
-        set.insert(pseudoObjectExpr->getResultExpr());
-        return set;
+        list.push_back(pseudoObjectExpr->getResultExpr());
+        return list;
     }
     
     if (const OpaqueValueExpr *opaqueValueExpr = llvm::dyn_cast<OpaqueValueExpr>(expr)) {
-        set.insert(opaqueValueExpr->getSourceExpr());
-        return set;
+        list.push_back(opaqueValueExpr->getSourceExpr());
+        return list;
     }
 
-    set.insert(expr);
+    list.push_back(expr);
     
-    return set;
+    return list;
 }
 
-std::set<const clang::Expr *> NullabilityDependencyExpandVisitor::VisitConditionalOperator(const clang::ConditionalOperator *expr) {
-    std::set<const Expr *> set;
+NullabilityDependencyList NullabilityDependencyExpandVisitor::VisitConditionalOperator(const clang::ConditionalOperator *expr) {
+    NullabilityDependencyList list;
     
-    set.insert(expr->getTrueExpr());
-    set.insert(expr->getFalseExpr());
+    list.push_back(expr->getTrueExpr());
+    list.push_back(expr->getFalseExpr());
 
-    return set;
+    return list;
 }
 
-std::set<const clang::Expr *> NullabilityDependencyExpandVisitor::VisitBinaryConditionalOperator(const clang::BinaryConditionalOperator *expr) {
-    std::set<const Expr *> set;
+NullabilityDependencyList NullabilityDependencyExpandVisitor::VisitBinaryConditionalOperator(const clang::BinaryConditionalOperator *expr) {
+    NullabilityDependencyList list;
     
-    set.insert(expr->getFalseExpr());
+    list.push_back(expr->getFalseExpr());
     
-    return set;
+    return list;
 }
 
-std::set<const clang::Expr *> NullabilityDependencyExpandVisitor::VisitObjCMessageExpr(const clang::ObjCMessageExpr *expr) {
-    std::set<const Expr *> set;
+NullabilityDependencyList NullabilityDependencyExpandVisitor::VisitObjCMessageExpr(const clang::ObjCMessageExpr *expr) {
+    NullabilityDependencyList list;
     
     const Expr *receiver = expr->getInstanceReceiver();
     if (receiver) {
-        set.insert(receiver);
+        list.push_back(receiver);
     }
     
     const ObjCMethodDecl *method = expr->getMethodDecl();
     NullabilityKind kind = method->getReturnType().getTypePtr()->getNullability(_ASTContext).getValueOr(NullabilityKind::Unspecified);
     
     if (kind != NullabilityKind::NonNull) {
-        set.insert(expr);
+        list.push_back(expr);
     }
     
-    return set;
+    return list;
 }
 
-std::set<const clang::Expr *> NullabilityDependencyExpandVisitor::VisitDeclRefExpr(const clang::DeclRefExpr *expr) {
-    std::set<const Expr *> set;
+NullabilityDependencyList NullabilityDependencyExpandVisitor::VisitDeclRefExpr(const clang::DeclRefExpr *expr) {
+    NullabilityDependencyList list;
     
     const VarDecl *varDecl = llvm::dyn_cast<VarDecl>(expr->getDecl());
     if (varDecl) {
-        VariableReferenceExpander e(varDecl, set);
-        e.TraverseStmt(_MethodDecl->getBody());
+        auto definitions = _DefinitionIndex.lookup(varDecl);
+        list.append(definitions.begin(), definitions.end());
+    }
+    
+    return list;
+}
+
+const VariableDefinitionIndex &NullabilityDependencyCalculator::getDefinitionIndex() {
+    if (!_DefinitionIndex) {
+        _DefinitionIndex.reset(new VariableDefinitionIndex(_MethodDecl));
+    }
+    
+    return *_DefinitionIndex;
+}
+
+llvm::ArrayRef<const clang::Expr *> NullabilityDependencyCalculator::copyToAllocator(llvm::ArrayRef<const clang::Expr *> exprs) {
+    if (exprs.empty()) {
+        return llvm::None;
     }
     
-    return set;
+    const Expr **buffer = _Allocator.Allocate<const Expr *>(exprs.size());
+    std::copy(exprs.begin(), exprs.end(), buffer);
+    
+    return llvm::makeArrayRef(buffer, exprs.size());
 }
 
-std::set<const Expr *> NullabilityDependencyCalculator::calculate(const clang::ObjCMethodDecl *method, const clang::Expr *expr) {
-    NullabilityDependencyExpandVisitor visitor(_ASTContext, method);
-    std::set<const Expr *> set{expr};
+llvm::ArrayRef<const clang::Expr *> NullabilityDependencyCalculator::expand(const clang::Expr *expr) {
+    auto it = _Expansions.find(expr);
+    if (it != _Expansions.end()) {
+        return it->second;
+    }
     
-    while (true) {
-        std::set<const Expr *> nextSet = set;
+    NullabilityDependencyExpandVisitor visitor(_ASTContext, getDefinitionIndex());
+    return _Expansions[expr] = copyToAllocator(visitor.Visit(expr->IgnoreParenImpCasts()));
+}
+
+llvm::ArrayRef<const clang::Expr *> NullabilityDependencyCalculator::calculate(const clang::Expr *expr) {
+    auto memo = _Closures.find(expr);
+    if (memo != _Closures.end()) {
+        return memo->second;
+    }
+    
+    llvm::SmallPtrSet<const Expr *, 16> visited;
+    llvm::SmallVector<const Expr *, 16> closure{expr};
+    llvm::SmallVector<const Expr *, 16> worklist{expr};
+    visited.insert(expr);
+    
+    while (!worklist.empty()) {
+        const Expr *e = worklist.pop_back_val();
         
-        for (const Expr *e : set) {
-            auto set = visitor.Visit(e->IgnoreParenImpCasts());
-            nextSet.insert(set.begin(), set.end());
+        auto computed = _Closures.find(e);
+        if (computed != _Closures.end()) {
+            // Closure of e is already transitively closed; no need to expand its members again
+            for (const Expr *dep : computed->second) {
+                if (visited.insert(dep).second) {
+                    closure.push_back(dep);
+                }
+            }
+            continue;
         }
         
-        if (nextSet == set) {
-            break;
-        } else {
-            set = nextSet;
+        for (const Expr *dep : expand(e)) {
+            if (visited.insert(dep).second) {
+                closure.push_back(dep);
+                worklist.push_back(dep);
+            }
         }
     }
     
-    return set;
- }
\ No newline at end of file
+    return _Closures[expr] = copyToAllocator(closure);
+}
@@ -1,35 +1,73 @@
 #ifndef NullabilityDependencyCalculator_h
 #define NullabilityDependencyCalculator_h
 
-#include <unordered_map>
-#include <set>
-
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Allocator.h>
 #include <clang/AST/AST.h>
 #include "ExpressionNullabilityCalculator.h"
 
-class NullabilityDependencyExpandVisitor : public clang::ConstStmtVisitor<NullabilityDependencyExpandVisitor, std::set<const clang::Expr *>> {
+/**
+ Def-use index of a method body: maps each local variable to its initializer and to right hand sides of assignments to it.
+ The body is traversed once when the index is built.
+ */
+class VariableDefinitionIndex {
+    llvm::DenseMap<const clang::VarDecl *, llvm::SmallVector<const clang::Expr *, 2>> _Definitions;
+
+public:
+    explicit VariableDefinitionIndex(const clang::ObjCMethodDecl *methodDecl);
+
+    llvm::ArrayRef<const clang::Expr *> lookup(const clang::VarDecl *varDecl) const;
+};
+
+/**
+ Dependencies of an expression found by one step expansion.
+ */
+typedef llvm::SmallVector<const clang::Expr *, 2> NullabilityDependencyList;
+
+class NullabilityDependencyExpandVisitor : public clang::ConstStmtVisitor<NullabilityDependencyExpandVisitor, NullabilityDependencyList> {
     clang::ASTContext &_ASTContext;
-    const clang::ObjCMethodDecl *_MethodDecl;
-    
+    const VariableDefinitionIndex &_DefinitionIndex;
+
 public:
-    explicit NullabilityDependencyExpandVisitor(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl)
-    : _ASTContext(astContext), _MethodDecl(methodDecl) {}
-    
-    std::set<const clang::Expr *> VisitExpr(const clang::Expr *expr);
-    std::set<const clang::Expr *> VisitConditionalOperator(const clang::ConditionalOperator *expr);
-    std::set<const clang::Expr *> VisitBinaryConditionalOperator(const clang::BinaryConditionalOperator *expr);
-    std::set<const clang::Expr *> VisitObjCMessageExpr(const clang::ObjCMessageExpr *expr);
-    std::set<const clang::Expr *> VisitDeclRefExpr(const clang::DeclRefExpr *expr);
+    explicit NullabilityDependencyExpandVisitor(clang::ASTContext &astContext, const VariableDefinitionIndex &definitionIndex)
+    : _ASTContext(astContext), _DefinitionIndex(definitionIndex) {}
+
+    NullabilityDependencyList VisitExpr(const clang::Expr *expr);
+    NullabilityDependencyList VisitConditionalOperator(const clang::ConditionalOperator *expr);
+    NullabilityDependencyList VisitBinaryConditionalOperator(const clang::BinaryConditionalOperator *expr);
+    NullabilityDependencyList VisitObjCMessageExpr(const clang::ObjCMessageExpr *expr);
+    NullabilityDependencyList VisitDeclRefExpr(const clang::DeclRefExpr *expr);
 };
 
 
+/**
+ Calculates dependency of expressions in a method.
+ Definition index of the method is built on first query, and shared by following queries.
+ One step expansions and transitive closures are memoized, so that queries on nested expressions reuse each other's results.
+ Memoized results are allocated from allocator given by the caller, which can be reset after the method is checked.
+ */
 class NullabilityDependencyCalculator {
     clang::ASTContext &_ASTContext;
-    
+    const clang::ObjCMethodDecl *_MethodDecl;
+    llvm::BumpPtrAllocator &_Allocator;
+    std::unique_ptr<VariableDefinitionIndex> _DefinitionIndex;
+    llvm::DenseMap<const clang::Expr *, llvm::ArrayRef<const clang::Expr *>> _Expansions;
+    llvm::DenseMap<const clang::Expr *, llvm::ArrayRef<const clang::Expr *>> _Closures;
+
+    const VariableDefinitionIndex &getDefinitionIndex();
+    llvm::ArrayRef<const clang::Expr *> expand(const clang::Expr *expr);
+    llvm::ArrayRef<const clang::Expr *> copyToAllocator(llvm::ArrayRef<const clang::Expr *> exprs);
+
 public:
-    explicit NullabilityDependencyCalculator(clang::ASTContext &astContext) : _ASTContext(astContext) {}
-    
-    std::set<const clang::Expr *> calculate(const clang::ObjCMethodDecl *method, const clang::Expr *expr);
+    explicit NullabilityDependencyCalculator(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl, llvm::BumpPtrAllocator &allocator)
+    : _ASTContext(astContext), _MethodDecl(methodDecl), _Allocator(allocator) {}
+
+    /**
+     Returns transitive closure of dependencies of expr, including expr itself.
+     */
+    llvm::ArrayRef<const clang::Expr *> calculate(const clang::Expr *expr);
 };
 
 #endif
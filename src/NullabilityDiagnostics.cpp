@@ -0,0 +1,64 @@
+#include <llvm/ADT/StringSwitch.h>
+
+#include "NullabilityDiagnostics.h"
+
+using namespace clang;
+
+bool NullabilityCheckSet::disable(llvm::StringRef name) {
+    const unsigned Unknown = ~0u;
+    
+    unsigned check = llvm::StringSwitch<unsigned>(name)
+    .Case("redundant-cast", static_cast<unsigned>(NullabilityCheck::RedundantCast))
+    .Case("cast-base-type", static_cast<unsigned>(NullabilityCheck::CastBaseType))
+    .Case("redundant-conditional", static_cast<unsigned>(NullabilityCheck::RedundantConditional))
+    .Case("collection-literal", static_cast<unsigned>(NullabilityCheck::CollectionLiteral))
+    .Case("block-type", static_cast<unsigned>(NullabilityCheck::BlockType))
+    .Case("initializer", static_cast<unsigned>(NullabilityCheck::Initializer))
+    .Default(Unknown);
+    
+    if (check == Unknown) {
+        return false;
+    }
+    
+    disable(static_cast<NullabilityCheck>(check));
+    return true;
+}
+
+struct NullabilityDiagnosticInfo {
+    NullabilityDiagnostic Diagnostic;
+    DiagnosticIDs::Level Level;
+    const char *Format;
+};
+
+static const NullabilityDiagnosticInfo DiagnosticInfos[] = {
+    { NullabilityDiagnostic::VariableDeclaration, DiagnosticIDs::Warning, "Nullability mismatch on variable declaration" },
+    { NullabilityDiagnostic::VariableDeclarationBlockType, DiagnosticIDs::Warning, "Nullability mismatch inside block type on variable declaration" },
+    { NullabilityDiagnostic::Argument, DiagnosticIDs::Warning, "%0 expects nonnull argument" },
+    { NullabilityDiagnostic::ArgumentBlockType, DiagnosticIDs::Warning, "Argument does not have expected block type to %0" },
+    { NullabilityDiagnostic::Assignment, DiagnosticIDs::Warning, "Nullability mismatch on assignment" },
+    { NullabilityDiagnostic::AssignmentBlockType, DiagnosticIDs::Warning, "Nullability mismatch inside block type on assignment" },
+    { NullabilityDiagnostic::Return, DiagnosticIDs::Warning, "%select{|Block in }0%1 expects nonnull to return" },
+    { NullabilityDiagnostic::ReturnBlockType, DiagnosticIDs::Warning, "Does not return expected type for %select{|block in }0%1" },
+    { NullabilityDiagnostic::ArrayElement, DiagnosticIDs::Warning, "Array element should be nonnull" },
+    { NullabilityDiagnostic::DictionaryKey, DiagnosticIDs::Warning, "Dictionary key should be nonnull" },
+    { NullabilityDiagnostic::DictionaryValue, DiagnosticIDs::Warning, "Dictionary value should be nonnull" },
+    { NullabilityDiagnostic::RedundantConditional, DiagnosticIDs::Warning, "Conditional operator looks redundant" },
+    { NullabilityDiagnostic::RedundantCast, DiagnosticIDs::Warning, "Redundant cast to nonnull" },
+    { NullabilityDiagnostic::CastBaseType, DiagnosticIDs::Warning, "Cast on nullability cannot change base type" },
+    { NullabilityDiagnostic::UninitializedIvar, DiagnosticIDs::Warning, "Nonnull ivar should be initialized: %0" },
+    { NullabilityDiagnostic::VariableNullability, DiagnosticIDs::Remark, "Variable nullability: %0" },
+};
+
+NullabilityDiagnosticCatalog::NullabilityDiagnosticCatalog(clang::DiagnosticsEngine &engine) : _Engine(engine) {
+    static_assert(sizeof(DiagnosticInfos) / sizeof(DiagnosticInfos[0]) == static_cast<unsigned>(NullabilityDiagnostic::NumDiagnostics),
+                  "Every diagnostic should have its info");
+    
+    // DiagnosticsEngine::getCustomDiagID only accepts string literals
+    DiagnosticIDs &ids = *engine.getDiagnosticIDs();
+    
+    for (auto &info : DiagnosticInfos) {
+        _IDs[static_cast<unsigned>(info.Diagnostic)] = ids.getCustomDiagID(info.Level, info.Format);
+    }
+    
+    _IgnoredID = engine.getCustomDiagID(DiagnosticsEngine::Ignored, "%0");
+}
@@ -0,0 +1,80 @@
+#ifndef NullabilityDiagnostics_h
+#define NullabilityDiagnostics_h
+
+#include <llvm/ADT/StringRef.h>
+#include <clang/Basic/Diagnostic.h>
+
+/**
+ Checks which can be disabled with `-disable-check=NAME`.
+ */
+enum class NullabilityCheck : unsigned {
+    RedundantCast = 0,      // redundant-cast
+    CastBaseType,           // cast-base-type
+    RedundantConditional,   // redundant-conditional
+    CollectionLiteral,      // collection-literal
+    BlockType,              // block-type
+    Initializer,            // initializer
+};
+
+class NullabilityCheckSet {
+    unsigned _Disabled;
+    
+public:
+    explicit NullabilityCheckSet() : _Disabled(0) {}
+    
+    bool isEnabled(NullabilityCheck check) const {
+        return !(_Disabled & (1u << static_cast<unsigned>(check)));
+    }
+    
+    void disable(NullabilityCheck check) {
+        _Disabled |= 1u << static_cast<unsigned>(check);
+    }
+    
+    /**
+     Disables check by its name. Returns false if no check has the name.
+     */
+    bool disable(llvm::StringRef name);
+};
+
+enum class NullabilityDiagnostic : unsigned {
+    VariableDeclaration = 0,
+    VariableDeclarationBlockType,
+    Argument,
+    ArgumentBlockType,
+    Assignment,
+    AssignmentBlockType,
+    Return,
+    ReturnBlockType,
+    ArrayElement,
+    DictionaryKey,
+    DictionaryValue,
+    RedundantConditional,
+    RedundantCast,
+    CastBaseType,
+    UninitializedIvar,
+    VariableNullability,
+    
+    NumDiagnostics
+};
+
+/**
+ Custom diagnostics of nullarihyon, registered to DiagnosticsEngine once on construction.
+ */
+class NullabilityDiagnosticCatalog {
+    clang::DiagnosticsEngine &_Engine;
+    unsigned _IDs[static_cast<unsigned>(NullabilityDiagnostic::NumDiagnostics)];
+    unsigned _IgnoredID;
+    
+public:
+    explicit NullabilityDiagnosticCatalog(clang::DiagnosticsEngine &engine);
+    
+    /**
+     Reports the diagnostic, or reports nothing visible if ignored (for warnings rejected by filter).
+     */
+    clang::DiagnosticBuilder report(clang::SourceLocation location, NullabilityDiagnostic diagnostic, bool ignored = false) {
+        unsigned id = ignored ? _IgnoredID : _IDs[static_cast<unsigned>(diagnostic)];
+        return _Engine.Report(location, id);
+    }
+};
+
+#endif
@@ -0,0 +1,415 @@
+#include <deque>
+#include <algorithm>
+
+#include <clang/AST/RecursiveASTVisitor.h>
+
+#include "NullabilityFlowAnalysis.h"
+#include "ExpressionNullabilityCalculator.h"
+
+using namespace clang;
+
+static const VarDecl *referencedVariable(const Expr *expr) {
+    expr = expr->IgnoreParenImpCasts();
+
+    if (const OpaqueValueExpr *opaque = llvm::dyn_cast<OpaqueValueExpr>(expr)) {
+        if (!opaque->getSourceExpr()) {
+            return nullptr;
+        }
+        expr = opaque->getSourceExpr()->IgnoreParenImpCasts();
+    }
+
+    const DeclRefExpr *ref = llvm::dyn_cast<DeclRefExpr>(expr);
+    if (ref) {
+        return llvm::dyn_cast<VarDecl>(ref->getDecl());
+    } else {
+        return nullptr;
+    }
+}
+
+/**
+ Returns variable whose value may be changed by stmt.
+ */
+static const VarDecl *assignedVariable(const Stmt *stmt) {
+    if (const BinaryOperator *binop = llvm::dyn_cast<BinaryOperator>(stmt)) {
+        if (binop->isAssignmentOp()) {
+            return referencedVariable(binop->getLHS());
+        }
+    }
+
+    if (const UnaryOperator *unop = llvm::dyn_cast<UnaryOperator>(stmt)) {
+        if (unop->getOpcode() == UO_AddrOf) {
+            // Assume the variable is updated through the pointer
+            return referencedVariable(unop->getSubExpr());
+        }
+    }
+
+    if (const DeclStmt *declStmt = llvm::dyn_cast<DeclStmt>(stmt)) {
+        // CFG splits declarations into DeclStmts with single decl
+        if (declStmt->isSingleDecl()) {
+            return llvm::dyn_cast<VarDecl>(declStmt->getSingleDecl());
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ Returns the condition tested at the terminator of block.
+ Logical operators are split into blocks, and each block tests the rightmost operand evaluated in it.
+ */
+static const Expr *branchCondition(const CFGBlock &block) {
+    const Expr *cond = llvm::dyn_cast_or_null<Expr>(block.getTerminatorCondition());
+
+    while (cond) {
+        const BinaryOperator *binop = llvm::dyn_cast<BinaryOperator>(cond->IgnoreParens());
+        if (!binop || !binop->isLogicalOp()) {
+            break;
+        }
+        cond = binop->getRHS();
+    }
+
+    return cond;
+}
+
+/**
+ Narrowing for bodies without CFG, as branch checkers did before the flow analysis.
+ Variables tested by condition of if are nonnull in its then clause, and ones tested by left operand of && are nonnull in its right operand.
+ Narrowing ends where the variable is assigned, and after the clause or operand assigning it.
+ */
+class SyntacticNarrowingVisitor : public RecursiveASTVisitor<SyntacticNarrowingVisitor> {
+    std::vector<const VarDecl *> _Narrowed;
+    llvm::DenseSet<const VarDecl *> _Assigned;
+    llvm::DenseSet<const Stmt *> &_References;
+
+    static void collectTestedVariables(const Expr *cond, std::vector<const VarDecl *> &vars) {
+        const BinaryOperator *binop = llvm::dyn_cast<BinaryOperator>(cond->IgnoreParens());
+        if (binop && binop->getOpcode() == BO_LAnd) {
+            collectTestedVariables(binop->getLHS(), vars);
+            collectTestedVariables(binop->getRHS(), vars);
+        } else if (const VarDecl *var = referencedVariable(cond)) {
+            vars.push_back(var);
+        }
+    }
+
+    void assign(const VarDecl *var) {
+        _Assigned.insert(var);
+        _Narrowed.erase(std::remove(_Narrowed.begin(), _Narrowed.end(), var), _Narrowed.end());
+    }
+
+    void traverseNarrowed(Stmt *stmt, const Expr *cond) {
+        std::vector<const VarDecl *> outer = _Narrowed;
+        llvm::DenseSet<const VarDecl *> outerAssigned;
+        std::swap(outerAssigned, _Assigned);
+
+        collectTestedVariables(cond, _Narrowed);
+        TraverseStmt(stmt);
+
+        _Narrowed.clear();
+        for (auto var : outer) {
+            if (_Assigned.find(var) == _Assigned.end()) {
+                _Narrowed.push_back(var);
+            }
+        }
+
+        for (auto var : _Assigned) {
+            outerAssigned.insert(var);
+        }
+        std::swap(outerAssigned, _Assigned);
+    }
+
+public:
+    explicit SyntacticNarrowingVisitor(const std::vector<const VarDecl *> &narrowed, llvm::DenseSet<const Stmt *> &references)
+    : _Narrowed(narrowed), _References(references) {}
+
+    bool TraverseIfStmt(IfStmt *ifStmt) {
+        TraverseStmt(ifStmt->getConditionVariableDeclStmt());
+        TraverseStmt(ifStmt->getCond());
+        traverseNarrowed(ifStmt->getThen(), ifStmt->getCond());
+        TraverseStmt(ifStmt->getElse());
+
+        return true;
+    }
+
+    bool TraverseBinLAnd(BinaryOperator *land) {
+        TraverseStmt(land->getLHS());
+        traverseNarrowed(land->getRHS(), land->getLHS());
+
+        return true;
+    }
+
+    bool TraverseBinAssign(BinaryOperator *assignment) {
+        // Right hand side is evaluated before the variable is updated
+        TraverseStmt(assignment->getRHS());
+        if (const VarDecl *var = referencedVariable(assignment->getLHS())) {
+            assign(var);
+        }
+        TraverseStmt(assignment->getLHS());
+
+        return true;
+    }
+
+    bool VisitUnaryAddrOf(UnaryOperator *unop) {
+        if (const VarDecl *var = referencedVariable(unop->getSubExpr())) {
+            assign(var);
+        }
+
+        return true;
+    }
+
+    bool VisitObjCForCollectionStmt(ObjCForCollectionStmt *stmt) {
+        const Expr *element = llvm::dyn_cast<Expr>(stmt->getElement());
+        if (const VarDecl *var = element ? referencedVariable(element) : nullptr) {
+            assign(var);
+        }
+
+        return true;
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *ref) {
+        const VarDecl *var = llvm::dyn_cast<VarDecl>(ref->getDecl());
+        if (var && std::find(_Narrowed.begin(), _Narrowed.end(), var) != _Narrowed.end()) {
+            _References.insert(ref);
+        }
+
+        return true;
+    }
+};
+
+NullabilityFlowAnalysis::NullabilityFlowAnalysis(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl) : _ASTContext(astContext) {
+    std::vector<BlockGraph> blocks;
+    Graph *graph = addGraph(methodDecl, methodDecl->getBody(), blocks);
+
+    if (!graph) {
+        addSyntacticNarrowing(methodDecl->getBody(), llvm::BitVector(_Variables.size()));
+        return;
+    }
+
+    solve(*graph, llvm::BitVector(_Variables.size()));
+
+    // Blocks are listed after the graph they appear in
+    for (auto &block : blocks) {
+        llvm::BitVector facts(_Variables.size());
+
+        auto it = _Positions.find(block._BlockExpr);
+        if (it != _Positions.end()) {
+            const Position &position = it->second;
+            unsigned id = position._Block->getBlockID();
+
+            if (block._Parent->_Reached[id]) {
+                facts = block._Parent->_EntryFacts[id];
+                transfer(*position._Block, position._Index, facts);
+            }
+        }
+
+        if (block._Graph) {
+            solve(*block._Graph, facts);
+        } else {
+            addSyntacticNarrowing(block._BlockExpr->getBlockDecl()->getBody(), facts);
+        }
+    }
+}
+
+void NullabilityFlowAnalysis::addSyntacticNarrowing(clang::Stmt *body, const llvm::BitVector &entryFacts) {
+    if (!body) {
+        return;
+    }
+
+    std::vector<const VarDecl *> narrowed;
+    for (auto &variable : _Variables) {
+        if (entryFacts.test(variable.second)) {
+            narrowed.push_back(variable.first);
+        }
+    }
+
+    SyntacticNarrowingVisitor visitor(narrowed, _NarrowedReferences);
+    visitor.TraverseStmt(body);
+}
+
+NullabilityFlowAnalysis::Graph *NullabilityFlowAnalysis::addGraph(const clang::Decl *decl, clang::Stmt *body, std::vector<BlockGraph> &blocks) {
+    if (!body) {
+        return nullptr;
+    }
+
+    CFG::BuildOptions options;
+    options.setAllAlwaysAdd();
+
+    std::unique_ptr<CFG> cfg = CFG::buildCFG(decl, body, &_ASTContext, options);
+    if (!cfg) {
+        // CFG is not available for some statements (like @try); no variable is narrowed in the body
+        return nullptr;
+    }
+
+    Graph *graph = new Graph;
+    graph->_CFG = std::move(cfg);
+    _Graphs.push_back(std::unique_ptr<Graph>(graph));
+
+    std::vector<const BlockExpr *> blockExprs;
+
+    for (const CFGBlock *block : *graph->_CFG) {
+        unsigned index = 0;
+        for (auto it = block->begin(); it != block->end(); it++, index++) {
+            if (Optional<CFGStmt> stmt = it->getAs<CFGStmt>()) {
+                Position position{ graph, block, index };
+                _Positions.insert(std::make_pair(stmt->getStmt(), position));
+
+                if (const BlockExpr *blockExpr = llvm::dyn_cast<BlockExpr>(stmt->getStmt())) {
+                    blockExprs.push_back(blockExpr);
+                }
+            }
+        }
+
+        if (block->succ_size() == 2) {
+            const Expr *cond = branchCondition(*block);
+            const VarDecl *var = cond ? referencedVariable(cond) : nullptr;
+            if (var && isPointerType(var->getType().getTypePtr()) && _Variables.find(var) == _Variables.end()) {
+                unsigned variableIndex = _Variables.size();
+                _Variables[var] = variableIndex;
+            }
+        }
+    }
+
+    for (auto blockExpr : blockExprs) {
+        // Reserve the entry before adding nested blocks, so that parents are solved before children
+        size_t index = blocks.size();
+        blocks.push_back(BlockGraph{ graph, blockExpr, nullptr });
+
+        // Nested blocks are appended to blocks, which may reallocate it; index after adding them
+        const BlockDecl *blockDecl = blockExpr->getBlockDecl();
+        Graph *child = addGraph(blockDecl, blockDecl->getBody(), blocks);
+        blocks[index]._Graph = child;
+    }
+
+    return graph;
+}
+
+int NullabilityFlowAnalysis::narrowedVariableIndex(const clang::CFGBlock &block) const {
+    if (block.succ_size() != 2) {
+        return -1;
+    }
+
+    const Expr *cond = branchCondition(block);
+    if (!cond) {
+        return -1;
+    }
+
+    const VarDecl *var = referencedVariable(cond);
+    if (!var) {
+        return -1;
+    }
+
+    auto it = _Variables.find(var);
+    if (it != _Variables.end()) {
+        return it->second;
+    } else {
+        return -1;
+    }
+}
+
+void NullabilityFlowAnalysis::transfer(const clang::CFGBlock &block, unsigned count, llvm::BitVector &facts) const {
+    unsigned index = 0;
+    for (auto it = block.begin(); it != block.end() && index < count; it++, index++) {
+        if (Optional<CFGStmt> stmt = it->getAs<CFGStmt>()) {
+            const VarDecl *var = assignedVariable(stmt->getStmt());
+            if (var) {
+                auto variable = _Variables.find(var);
+                if (variable != _Variables.end()) {
+                    facts.reset(variable->second);
+                }
+            }
+        }
+    }
+}
+
+void NullabilityFlowAnalysis::solve(Graph &graph, const llvm::BitVector &entryFacts) {
+    unsigned numBlocks = graph._CFG->getNumBlockIDs();
+
+    graph._EntryFacts.assign(numBlocks, llvm::BitVector(_Variables.size()));
+    graph._Reached.assign(numBlocks, false);
+
+    const CFGBlock &entry = graph._CFG->getEntry();
+    graph._EntryFacts[entry.getBlockID()] = entryFacts;
+    graph._Reached[entry.getBlockID()] = true;
+
+    std::deque<const CFGBlock *> worklist{ &entry };
+    std::vector<bool> queued(numBlocks, false);
+    queued[entry.getBlockID()] = true;
+
+    while (!worklist.empty()) {
+        const CFGBlock *block = worklist.front();
+        worklist.pop_front();
+        queued[block->getBlockID()] = false;
+
+        llvm::BitVector facts = graph._EntryFacts[block->getBlockID()];
+        transfer(*block, block->size(), facts);
+
+        int narrowed = narrowedVariableIndex(*block);
+
+        unsigned successorIndex = 0;
+        for (auto it = block->succ_begin(); it != block->succ_end(); it++, successorIndex++) {
+            const CFGBlock *successor = *it;
+            if (!successor) {
+                continue;
+            }
+
+            llvm::BitVector edgeFacts = facts;
+            if (successorIndex == 0 && narrowed >= 0) {
+                // First successor is the true branch
+                edgeFacts.set(narrowed);
+            }
+
+            unsigned id = successor->getBlockID();
+            bool changed;
+
+            if (graph._Reached[id]) {
+                llvm::BitVector joined = graph._EntryFacts[id];
+                joined &= edgeFacts;
+                changed = joined != graph._EntryFacts[id];
+                graph._EntryFacts[id] = joined;
+            } else {
+                graph._EntryFacts[id] = edgeFacts;
+                graph._Reached[id] = true;
+                changed = true;
+            }
+
+            if (changed && !queued[id]) {
+                queued[id] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+}
+
+bool NullabilityFlowAnalysis::isNonNull(const clang::Stmt *ref, const clang::VarDecl *var) const {
+    if (_NarrowedReferences.find(ref) != _NarrowedReferences.end()) {
+        return true;
+    }
+
+    auto variable = _Variables.find(var);
+    if (variable == _Variables.end()) {
+        return false;
+    }
+
+    auto it = _Positions.find(ref);
+    if (it == _Positions.end()) {
+        return false;
+    }
+
+    const Position &position = it->second;
+    unsigned id = position._Block->getBlockID();
+
+    if (!position._Graph->_Reached[id] || !position._Graph->_EntryFacts[id].test(variable->second)) {
+        return false;
+    }
+
+    // Narrowing is only introduced on edges; look for assignments before ref in the block
+    unsigned index = 0;
+    for (auto e = position._Block->begin(); e != position._Block->end() && index < position._Index; e++, index++) {
+        if (Optional<CFGStmt> stmt = e->getAs<CFGStmt>()) {
+            if (assignedVariable(stmt->getStmt()) == var) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef NullabilityFlowAnalysis_h
+#define NullabilityFlowAnalysis_h
+
+#include <vector>
+#include <memory>
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <clang/AST/AST.h>
+#include <clang/Analysis/CFG.h>
+
+/**
+ Forward dataflow analysis on CFG which finds variables tested to be nonnull.
+
+ A variable is nonnull on true branch of condition which is a reference to the variable (`if (x)`, `x && ...`, `while (x)`),
+ until it is assigned. Facts are bitvectors indexed by variables, and intersected at join points.
+ Bodies of blocks are analyzed separately, starting from facts at the block expression.
+ Bodies without CFG (like those with @try) are narrowed on syntax instead: by conditions of if and left operands of &&, until assigned.
+ */
+class NullabilityFlowAnalysis {
+    struct Graph {
+        std::unique_ptr<clang::CFG> _CFG;
+        std::vector<llvm::BitVector> _EntryFacts;
+        std::vector<bool> _Reached;
+    };
+
+    struct BlockGraph {
+        const Graph *_Parent;
+        const clang::BlockExpr *_BlockExpr;
+        Graph *_Graph;
+    };
+
+    struct Position {
+        const Graph *_Graph;
+        const clang::CFGBlock *_Block;
+        unsigned _Index;
+    };
+
+    clang::ASTContext &_ASTContext;
+    std::vector<std::unique_ptr<Graph>> _Graphs;
+    llvm::DenseMap<const clang::VarDecl *, unsigned> _Variables;
+    llvm::DenseMap<const clang::Stmt *, Position> _Positions;
+    llvm::DenseSet<const clang::Stmt *> _NarrowedReferences;
+
+    Graph *addGraph(const clang::Decl *decl, clang::Stmt *body, std::vector<BlockGraph> &blocks);
+    void solve(Graph &graph, const llvm::BitVector &entryFacts);
+    int narrowedVariableIndex(const clang::CFGBlock &block) const;
+    void transfer(const clang::CFGBlock &block, unsigned count, llvm::BitVector &facts) const;
+    void addSyntacticNarrowing(clang::Stmt *body, const llvm::BitVector &entryFacts);
+
+public:
+    explicit NullabilityFlowAnalysis(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl);
+
+    /**
+     Returns true if var is tested to be nonnull when ref is evaluated.
+     */
+    bool isNonNull(const clang::Stmt *ref, const clang::VarDecl *var) const;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "NullabilitySignature.h"
+
+using namespace clang;
+
+static ExpressionNullability declaredNullability(ASTContext &astContext, QualType qualType, NullabilityKind defaultKind) {
+    const Type *type = qualType.getTypePtr();
+    return ExpressionNullability(type, type->getNullability(astContext).getValueOr(defaultKind));
+}
+
+MethodNullabilitySignature::MethodNullabilitySignature(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl) {
+    _Params.reserve(methodDecl->param_size());
+    for (auto param : methodDecl->params()) {
+        _Params.push_back(declaredNullability(astContext, param->getType(), NullabilityKind::Unspecified));
+    }
+}
+
+const MethodNullabilitySignature &NullabilitySignatureCache::signature(const clang::ObjCMethodDecl *methodDecl) {
+    auto it = _Signatures.find(methodDecl);
+    if (it != _Signatures.end()) {
+        return it->second;
+    }
+    
+    return _Signatures[methodDecl] = MethodNullabilitySignature(_ASTContext, methodDecl);
+}
+
+NullabilityCompatibility NullabilitySignatureCache::compatibility(const clang::Type *lhsType, clang::NullabilityKind lhsKind, const clang::Type *rhsType, clang::NullabilityKind rhsKind) {
+    if (lhsKind == NullabilityKind::NonNull) {
+        if (rhsKind != NullabilityKind::NonNull) {
+            return NullabilityCompatibility::IncompatibleTopLevel;
+        }
+    }
+    
+    if (!_CheckBlockTypes) {
+        return NullabilityCompatibility::Compatible;
+    }
+    
+    lhsType = lhsType->getUnqualifiedDesugaredType();
+    rhsType = rhsType->getUnqualifiedDesugaredType();
+    
+    if (lhsType->isBlockPointerType() && rhsType->isBlockPointerType()) {
+        return blockCompatibility(llvm::cast<BlockPointerType>(lhsType), llvm::cast<BlockPointerType>(rhsType));
+    }
+    
+    return NullabilityCompatibility::Compatible;
+}
+
+NullabilityCompatibility NullabilitySignatureCache::blockCompatibility(const clang::BlockPointerType *lhsType, const clang::BlockPointerType *rhsType) {
+    // Block pointer types are uniqued with their sugared pointee types, so nullability of params is part of the key
+    std::pair<const Type *, const Type *> key(lhsType, rhsType);
+    
+    auto it = _BlockCompatibilities.find(key);
+    if (it != _BlockCompatibilities.end()) {
+        return it->second;
+    }
+    
+    NullabilityCompatibility result = NullabilityCompatibility::Compatible;
+    
+    const FunctionProtoType *lhsFuncType = llvm::dyn_cast<FunctionProtoType>(lhsType->getPointeeType().IgnoreParens().getTypePtr());
+    const FunctionProtoType *rhsFuncType = llvm::dyn_cast<FunctionProtoType>(rhsType->getPointeeType().IgnoreParens().getTypePtr());
+    
+    if (lhsFuncType && rhsFuncType) {
+        ExpressionNullability lhsReturn = declaredNullability(_ASTContext, lhsFuncType->getReturnType(), NullabilityKind::Nullable);
+        ExpressionNullability rhsReturn = declaredNullability(_ASTContext, rhsFuncType->getReturnType(), NullabilityKind::Nullable);
+        
+        unsigned lhsNumParams = lhsFuncType->getNumParams();
+        unsigned rhsNumParams = rhsFuncType->getNumParams();
+        
+        if (compatibility(lhsReturn, rhsReturn) != NullabilityCompatibility::Compatible) {
+            // Covariant
+            result = NullabilityCompatibility::IncompatibleNested;
+        } else if (lhsNumParams != rhsNumParams) {
+            result = NullabilityCompatibility::IncompatibleNested;
+        } else {
+            for (unsigned index = 0; index < lhsNumParams; index++) {
+                ExpressionNullability lhsParam = declaredNullability(_ASTContext, lhsFuncType->getParamType(index), NullabilityKind::Nullable);
+                ExpressionNullability rhsParam = declaredNullability(_ASTContext, rhsFuncType->getParamType(index), NullabilityKind::Nullable);
+                
+                // Contravariant
+                if (compatibility(rhsParam, lhsParam) != NullabilityCompatibility::Compatible) {
+                    result = NullabilityCompatibility::IncompatibleNested;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return _BlockCompatibilities[key] = result;
+}
@@ -0,0 +1,63 @@
+#ifndef NullabilitySignature_h
+#define NullabilitySignature_h
+
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <clang/AST/AST.h>
+
+#include "ExpressionNullabilityCalculator.h"
+
+enum class NullabilityCompatibility : uint8_t {
+    Compatible = 0,
+    IncompatibleTopLevel,
+    IncompatibleNested
+};
+
+/**
+ Nullability of parameters of a method, taken from their declared types.
+ Return is not included; nullability of message sends depends on selector rules, and is calculated by ExpressionNullabilityCalculator.
+ */
+class MethodNullabilitySignature {
+    std::vector<ExpressionNullability> _Params;
+    
+public:
+    explicit MethodNullabilitySignature() {}
+    explicit MethodNullabilitySignature(clang::ASTContext &astContext, const clang::ObjCMethodDecl *methodDecl);
+    
+    const std::vector<ExpressionNullability> &getParams() const {
+        return _Params;
+    }
+};
+
+/**
+ Method signatures and results of compatibility test, shared in a translation unit.
+ */
+class NullabilitySignatureCache {
+    clang::ASTContext &_ASTContext;
+    bool _CheckBlockTypes;
+    llvm::DenseMap<const clang::ObjCMethodDecl *, MethodNullabilitySignature> _Signatures;
+    
+    /**
+     Results of nested compatibility test of block types, keyed by (lhs type, rhs type).
+     */
+    llvm::DenseMap<std::pair<const clang::Type *, const clang::Type *>, NullabilityCompatibility> _BlockCompatibilities;
+    
+    NullabilityCompatibility blockCompatibility(const clang::BlockPointerType *lhsType, const clang::BlockPointerType *rhsType);
+    
+public:
+    /**
+     Nullability inside block types is not tested if checkBlockTypes is false.
+     */
+    explicit NullabilitySignatureCache(clang::ASTContext &astContext, bool checkBlockTypes = true) : _ASTContext(astContext), _CheckBlockTypes(checkBlockTypes) {}
+    
+    const MethodNullabilitySignature &signature(const clang::ObjCMethodDecl *methodDecl);
+    
+    NullabilityCompatibility compatibility(const clang::Type *lhsType, clang::NullabilityKind lhsKind, const clang::Type *rhsType, clang::NullabilityKind rhsKind);
+    
+    NullabilityCompatibility compatibility(const ExpressionNullability &lhs, const ExpressionNullability &rhs) {
+        return compatibility(lhs.getType(), lhs.getNullability(), rhs.getType(), rhs.getNullability());
+    }
+};
+
+#endif
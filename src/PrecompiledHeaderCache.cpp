@@ -0,0 +1,402 @@
+#include <map>
+#include <tuple>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeValue.h>
+#include <llvm/Support/raw_ostream.h>
+#include <clang/Basic/FileManager.h>
+#include <clang/Basic/VirtualFileSystem.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Tooling/Tooling.h>
+
+#include "PrecompiledHeaderCache.h"
+
+using namespace clang;
+using namespace clang::tooling;
+
+std::string PrecompiledHeaderCache::defaultRootPath() {
+    llvm::SmallString<256> path;
+    llvm::sys::path::system_temp_directory(true, path);
+    llvm::sys::path::append(path, "nullarihyon-pch");
+    
+    return path.str();
+}
+
+static std::string normalizedPath(llvm::StringRef directory, llvm::StringRef path) {
+    llvm::SmallString<256> result;
+    
+    if (!llvm::sys::path::is_absolute(path)) {
+        result = directory;
+    }
+    llvm::sys::path::append(result, path);
+    llvm::sys::path::remove_dots(result, true);
+    
+    return result.str();
+}
+
+PrecompiledHeaderCache::PrecompiledHeaderCache(llvm::StringRef rootPath, llvm::StringRef prefixHeaderPath) : _RootPath(rootPath) {
+    llvm::SmallString<256> path(prefixHeaderPath);
+    llvm::sys::fs::make_absolute(path);
+    llvm::sys::path::remove_dots(path, true);
+    
+    _PrefixHeaderPath = path.str();
+}
+
+size_t PrecompiledHeaderCache::prefixHeaderIndex(const std::vector<std::string> &commandLine, llvm::StringRef directory) const {
+    // Projects may -include other headers in OTHER_CFLAGS, before or after the prefix header
+    for (size_t index = 0; index + 1 < commandLine.size(); index++) {
+        if (commandLine[index] == "-include" && normalizedPath(directory, commandLine[index + 1]) == _PrefixHeaderPath) {
+            return index + 1;
+        }
+    }
+    
+    return 0;
+}
+
+std::vector<std::string> PrecompiledHeaderCache::parseDependencies(llvm::StringRef text) {
+    std::vector<std::string> dependencies;
+    
+    // Prerequisites follow the target; clang escapes spaces and # with backslash, and $ as $$
+    size_t colon = text.find(": ");
+    if (colon == llvm::StringRef::npos) {
+        return dependencies;
+    }
+    
+    std::string current;
+    auto flush = [&]() {
+        if (!current.empty()) {
+            dependencies.push_back(current);
+            current.clear();
+        }
+    };
+    
+    for (size_t index = colon + 1; index < text.size(); index++) {
+        char c = text[index];
+        char next = index + 1 < text.size() ? text[index + 1] : '\0';
+        
+        if (c == '\\' && (next == '\n' || next == '\r')) {
+            flush();
+            index++;
+        } else if (c == '\\' && (next == ' ' || next == '#')) {
+            current += next;
+            index++;
+        } else if (c == '$' && next == '$') {
+            current += '$';
+            index++;
+        } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            flush();
+        } else {
+            current += c;
+        }
+    }
+    
+    flush();
+    
+    return dependencies;
+}
+
+bool PrecompiledHeaderDependency::stat(llvm::StringRef path, PrecompiledHeaderDependency &dependency) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(path, status)) {
+        return false;
+    }
+    
+    llvm::sys::TimeValue modificationTime = status.getLastModificationTime();
+    
+    dependency.Path = path;
+    dependency.Size = status.getSize();
+    dependency.Seconds = modificationTime.toEpochTime();
+    dependency.Nanoseconds = modificationTime.nanoseconds();
+    
+    return true;
+}
+
+std::string PrecompiledHeaderCache::formatManifest(const std::vector<PrecompiledHeaderDependency> &dependencies) {
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    
+    for (auto &dependency : dependencies) {
+        os << dependency.Size << " " << dependency.Seconds << " " << dependency.Nanoseconds << " " << dependency.Path << "\n";
+    }
+    
+    return os.str();
+}
+
+std::vector<PrecompiledHeaderDependency> PrecompiledHeaderCache::parseManifest(llvm::StringRef text) {
+    std::vector<PrecompiledHeaderDependency> dependencies;
+    
+    llvm::SmallVector<llvm::StringRef, 16> lines;
+    text.split(lines, '\n', -1, false);
+    
+    for (auto line : lines) {
+        // Path is the rest of the line, and may contain spaces
+        llvm::StringRef size, seconds, nanoseconds;
+        std::tie(size, line) = line.split(' ');
+        std::tie(seconds, line) = line.split(' ');
+        std::tie(nanoseconds, line) = line.split(' ');
+        
+        PrecompiledHeaderDependency dependency;
+        if (size.getAsInteger(10, dependency.Size) || seconds.getAsInteger(10, dependency.Seconds) || nanoseconds.getAsInteger(10, dependency.Nanoseconds) || line.empty()) {
+            // Broken manifest makes PCH out of date
+            return std::vector<PrecompiledHeaderDependency>();
+        }
+        dependency.Path = line;
+        
+        dependencies.push_back(dependency);
+    }
+    
+    return dependencies;
+}
+
+std::string PrecompiledHeaderCache::pchPath(const CompileConfiguration &configuration) const {
+    llvm::SmallString<256> path(_RootPath);
+    llvm::sys::path::append(path, configuration.hash(), "prefix.pch");
+    
+    return path.str();
+}
+
+std::string PrecompiledHeaderCache::manifestPath(const CompileConfiguration &configuration) const {
+    llvm::SmallString<256> path(_RootPath);
+    llvm::sys::path::append(path, configuration.hash(), "prefix.deps");
+    
+    return path.str();
+}
+
+bool PrecompiledHeaderCache::checkUpToDate(const CompileConfiguration &configuration) const {
+    auto buffer = llvm::MemoryBuffer::getFile(manifestPath(configuration));
+    if (!buffer) {
+        return false;
+    }
+    
+    std::vector<PrecompiledHeaderDependency> dependencies = parseManifest((*buffer)->getBuffer());
+    if (dependencies.empty()) {
+        return false;
+    }
+    
+    // PCH itself, prefix header, headers it includes, SDK headers and module files; any change of size or modification time, even backwards, makes PCH stale
+    for (auto &dependency : dependencies) {
+        PrecompiledHeaderDependency current;
+        if (!PrecompiledHeaderDependency::stat(dependency.Path, current)) {
+            return false;
+        }
+        
+        if (!(current == dependency)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool PrecompiledHeaderCache::isUpToDate(const CompileConfiguration &configuration) const {
+    std::string hash = configuration.hash();
+    
+    {
+        std::lock_guard<std::mutex> lock(_UpToDateMutex);
+        auto it = _UpToDate.find(hash);
+        if (it != _UpToDate.end()) {
+            return it->second;
+        }
+    }
+    
+    bool upToDate = checkUpToDate(configuration);
+    
+    std::lock_guard<std::mutex> lock(_UpToDateMutex);
+    _UpToDate[hash] = upToDate;
+    
+    return upToDate;
+}
+
+/**
+ Writes manifest of PCH and dependencies listed in the dependency file. Returns false if a dependency is missing, or may have been changed while PCH was built.
+ PCH is recorded with its final path; it keeps size and modification time when it is renamed.
+ */
+static bool writeManifest(llvm::StringRef temporaryPCHPath, llvm::StringRef pchPath, llvm::StringRef dependencyFilePath, llvm::StringRef directory, int64_t started, llvm::StringRef path) {
+    auto buffer = llvm::MemoryBuffer::getFile(dependencyFilePath);
+    if (!buffer) {
+        return false;
+    }
+    
+    std::vector<PrecompiledHeaderDependency> dependencies;
+    
+    PrecompiledHeaderDependency pch;
+    if (!PrecompiledHeaderDependency::stat(temporaryPCHPath, pch)) {
+        return false;
+    }
+    pch.Path = pchPath;
+    dependencies.push_back(pch);
+    
+    for (auto &dependencyPath : PrecompiledHeaderCache::parseDependencies((*buffer)->getBuffer())) {
+        PrecompiledHeaderDependency dependency;
+        if (!PrecompiledHeaderDependency::stat(normalizedPath(directory, dependencyPath), dependency)) {
+            return false;
+        }
+        
+        // Modules may be built by the build itself, and are what PCH uses
+        if (llvm::sys::path::extension(dependency.Path) != ".pcm" && dependency.Seconds >= started) {
+            return false;
+        }
+        
+        dependencies.push_back(dependency);
+    }
+    
+    std::error_code error;
+    llvm::raw_fd_ostream os(path, error, llvm::sys::fs::F_Text);
+    if (error) {
+        return false;
+    }
+    
+    os << PrecompiledHeaderCache::formatManifest(dependencies);
+    os.close();
+    
+    bool failed = os.has_error();
+    os.clear_error();
+    
+    return !failed;
+}
+
+bool PrecompiledHeaderCache::prebuild(const CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths) {
+    struct Prebuild {
+        CompileConfiguration Configuration;
+        std::string Directory;
+    };
+    
+    // Configurations in order of their first files
+    std::vector<Prebuild> prebuilds;
+    std::map<std::string, size_t> indices;
+    
+    for (auto &path : sourcePaths) {
+        llvm::SmallString<256> absolutePath(path);
+        llvm::sys::fs::make_absolute(absolutePath);
+        
+        for (auto &command : compilations.getCompileCommands(absolutePath)) {
+            CompileConfiguration configuration(command.CommandLine, command.Directory, absolutePath);
+            if (prefixHeaderIndex(command.CommandLine, command.Directory) == 0) {
+                continue;
+            }
+            
+            std::string hash = configuration.hash();
+            if (indices.find(hash) == indices.end()) {
+                indices[hash] = prebuilds.size();
+                prebuilds.push_back(Prebuild{ configuration, command.Directory });
+            }
+        }
+    }
+    
+    // Resource directory is found relative to the executable
+    static int StaticSymbol;
+    std::string mainExecutable = llvm::sys::fs::getMainExecutable("nullarihyon-core", &StaticSymbol);
+    
+    // Source paths given later are resolved from the initial directory
+    IntrusiveRefCntPtr<vfs::FileSystem> realFileSystem = vfs::getRealFileSystem();
+    llvm::ErrorOr<std::string> initialDirectory = realFileSystem->getCurrentWorkingDirectory();
+    
+    bool success = true;
+    
+    for (auto &prebuild : prebuilds) {
+        if (isUpToDate(prebuild.Configuration)) {
+            continue;
+        }
+        
+        std::string path = pchPath(prebuild.Configuration);
+        if (llvm::sys::fs::create_directories(llvm::sys::path::parent_path(path))) {
+            success = false;
+            continue;
+        }
+        
+        // Written aside and renamed, so that analyses running meanwhile never see a partial PCH
+        llvm::SmallString<256> temporaryPath;
+        if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%", temporaryPath)) {
+            success = false;
+            continue;
+        }
+        std::string temporaryDependencyPath = std::string(temporaryPath.str()) + ".d";
+        
+        const std::vector<std::string> &flags = prebuild.Configuration.getFlags();
+        size_t prefixIndex = prefixHeaderIndex(flags, prebuild.Directory);
+        
+        // Session timestamp is not a part of configuration; modules are validated as they are just prebuilt
+        std::vector<std::string> commandLine{ mainExecutable };
+        for (size_t index = 0; index < flags.size(); index++) {
+            if (index + 1 == prefixIndex || index == prefixIndex) {
+                continue;
+            }
+            if (flags[index] == "-fsyntax-only" || flags[index] == "-fmodules-validate-once-per-build-session") {
+                continue;
+            }
+            commandLine.push_back(flags[index]);
+        }
+        commandLine.push_back("-MD");
+        commandLine.push_back("-MF");
+        commandLine.push_back(temporaryDependencyPath);
+        commandLine.push_back("-fmodule-file-deps");
+        commandLine.push_back("-o");
+        commandLine.push_back(temporaryPath.str());
+        commandLine.push_back("-x");
+        commandLine.push_back("objective-c-header");
+        commandLine.push_back(flags[prefixIndex]);
+        
+        // Relative prefix header and header search paths are resolved from the directory of the compile command
+        realFileSystem->setCurrentWorkingDirectory(prebuild.Directory);
+        
+        IntrusiveRefCntPtr<FileManager> files(new FileManager(FileSystemOptions()));
+        ToolInvocation invocation(std::move(commandLine), new GeneratePCHAction, files.get());
+        
+        // Analyses include the prefix header textually, and report its errors
+        IgnoringDiagConsumer diagnosticConsumer;
+        invocation.setDiagnosticConsumer(&diagnosticConsumer);
+        
+        // Modification times are truncated to seconds on some file systems; files changed in the second the build starts are treated as changed during the build
+        int64_t started = llvm::sys::TimeValue::now().toEpochTime();
+        
+        bool built = invocation.run();
+        
+        std::string temporaryManifestPath = std::string(temporaryPath.str()) + ".deps";
+        if (built) {
+            built = writeManifest(temporaryPath, path, temporaryDependencyPath, prebuild.Directory, started, temporaryManifestPath);
+        }
+        
+        // Manifest is renamed first; old PCH does not match new manifest, and looks out of date
+        if (built) {
+            built = !llvm::sys::fs::rename(temporaryManifestPath, manifestPath(prebuild.Configuration))
+                && !llvm::sys::fs::rename(temporaryPath, path);
+        }
+        
+        llvm::sys::fs::remove(temporaryDependencyPath);
+        if (!built) {
+            llvm::sys::fs::remove(temporaryManifestPath);
+            llvm::sys::fs::remove(temporaryPath);
+            success = false;
+        }
+        
+        std::lock_guard<std::mutex> lock(_UpToDateMutex);
+        _UpToDate.erase(prebuild.Configuration.hash());
+    }
+    
+    if (initialDirectory) {
+        realFileSystem->setCurrentWorkingDirectory(*initialDirectory);
+    }
+    
+    return success;
+}
+
+std::vector<std::string> PrecompiledHeaderCache::adjustCommandLine(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath) const {
+    size_t prefixIndex = prefixHeaderIndex(commandLine, directory);
+    if (prefixIndex == 0) {
+        return commandLine;
+    }
+    
+    CompileConfiguration configuration(commandLine, directory, sourcePath);
+    if (!isUpToDate(configuration)) {
+        return commandLine;
+    }
+    
+    std::vector<std::string> result = commandLine;
+    result[prefixIndex - 1] = "-include-pch";
+    result[prefixIndex] = pchPath(configuration);
+    
+    return result;
+}
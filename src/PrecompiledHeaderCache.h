@@ -0,0 +1,95 @@
+#ifndef PrecompiledHeaderCache_h
+#define PrecompiledHeaderCache_h
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include "CompileConfiguration.h"
+
+/**
+ Size and modification time of a file which PCH depends on, when PCH is built.
+ */
+struct PrecompiledHeaderDependency {
+    std::string Path;
+    uint64_t Size;
+    int64_t Seconds;
+    uint32_t Nanoseconds;
+    
+    /**
+     Reads size and modification time of the file at path. Returns false if it does not exist.
+     */
+    static bool stat(llvm::StringRef path, PrecompiledHeaderDependency &dependency);
+    
+    bool operator==(const PrecompiledHeaderDependency &other) const {
+        return Path == other.Path && Size == other.Size && Seconds == other.Seconds && Nanoseconds == other.Nanoseconds;
+    }
+};
+
+/**
+ Precompiled prefix header, in directories keyed by hash of compile configuration.
+ The prefix header is given explicitly, and found in command lines by its -include; other -include options are compiled as they are.
+ PCH is built by prebuild with a list of its dependencies (headers and module files), and is up to date while all of them have the size and modification time recorded at the build.
+ Command lines of analyses are changed to use up to date PCH; the prefix header is included as before if PCH is missing or stale.
+ */
+class PrecompiledHeaderCache {
+    std::string _RootPath;
+    std::string _PrefixHeaderPath;
+    mutable llvm::StringMap<bool> _UpToDate;
+    mutable std::mutex _UpToDateMutex;
+    
+    std::string manifestPath(const CompileConfiguration &configuration) const;
+    bool checkUpToDate(const CompileConfiguration &configuration) const;
+
+public:
+    /**
+     Relative prefixHeaderPath is resolved from the current directory.
+     */
+    explicit PrecompiledHeaderCache(llvm::StringRef rootPath, llvm::StringRef prefixHeaderPath);
+    
+    /**
+     Default root: nullarihyon-pch in the temporary directory of the user.
+     */
+    static std::string defaultRootPath();
+    
+    /**
+     Returns index of the value of -include which names the prefix header in command line or flags, or 0 if none.
+     Relative paths in command line are resolved from directory.
+     */
+    size_t prefixHeaderIndex(const std::vector<std::string> &commandLine, llvm::StringRef directory) const;
+    
+    /**
+     Reads make style dependency file, and returns the prerequisites.
+     */
+    static std::vector<std::string> parseDependencies(llvm::StringRef text);
+    
+    /**
+     Writes dependencies one per line, as size, modification time and path.
+     */
+    static std::string formatManifest(const std::vector<PrecompiledHeaderDependency> &dependencies);
+    static std::vector<PrecompiledHeaderDependency> parseManifest(llvm::StringRef text);
+    
+    std::string pchPath(const CompileConfiguration &configuration) const;
+    
+    /**
+     Up to date verdicts are memoized; the cache is shared by threads.
+     */
+    bool isUpToDate(const CompileConfiguration &configuration) const;
+    
+    /**
+     Builds PCH of prefix header for each configuration of the files, unless it is up to date.
+     Returns false if a build fails; analyses of the configuration include the prefix header.
+     */
+    bool prebuild(const clang::tooling::CompilationDatabase &compilations, const std::vector<std::string> &sourcePaths);
+    
+    /**
+     Replaces -include of prefix header with -include-pch, if PCH of the configuration is up to date.
+     */
+    std::vector<std::string> adjustCommandLine(const std::vector<std::string> &commandLine, llvm::StringRef directory, llvm::StringRef sourcePath) const;
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include <fstream>
+#include <sstream>
+
+#include "SelectorNullabilityTable.h"
+
+using namespace clang;
+
+SelectorNullabilityRules::SelectorNullabilityRules() {
+    std::string error;
+    parse("-class\n"
+          "-init\n"
+          "-alloc\n"
+          "+class\n"
+          "+alloc\n"
+          "+new\n", error);
+}
+
+bool SelectorNullabilityRules::loadFile(const std::string &path, std::string &error) {
+    std::ifstream stream(path);
+    if (!stream) {
+        error = "Cannot read " + path;
+        return false;
+    }
+    
+    std::stringstream text;
+    text << stream.rdbuf();
+    
+    if (!parse(text.str(), error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    
+    return true;
+}
+
+bool SelectorNullabilityRules::parse(llvm::StringRef text, std::string &error) {
+    std::vector<SelectorNullabilityRule> rules;
+    
+    llvm::SmallVector<llvm::StringRef, 32> lines;
+    text.split(lines, "\n");
+    
+    unsigned lineNumber = 0;
+    for (auto line : lines) {
+        lineNumber++;
+        
+        line = line.split('#').first.trim();
+        if (line.empty()) {
+            continue;
+        }
+        
+        SelectorNullabilityRule rule;
+        
+        if (!line.startswith("-") && !line.startswith("+")) {
+            error = "line " + std::to_string(lineNumber) + ": method should start with - or +";
+            return false;
+        }
+        
+        rule.ClassMethod = line.front() == '+';
+        line = line.drop_front();
+        
+        llvm::StringRef name;
+        llvm::StringRef kind;
+        
+        if (line.startswith("[")) {
+            // -[ClassName selector] kind
+            size_t close = line.find(']');
+            if (close == llvm::StringRef::npos) {
+                error = "line " + std::to_string(lineNumber) + ": missing ]";
+                return false;
+            }
+            
+            std::pair<llvm::StringRef, llvm::StringRef> method = line.slice(1, close).trim().split(' ');
+            rule.ClassName = method.first.str();
+            name = method.second.trim();
+            kind = line.drop_front(close + 1).trim();
+            
+            if (rule.ClassName.empty()) {
+                error = "line " + std::to_string(lineNumber) + ": missing class name";
+                return false;
+            }
+        } else {
+            // -selector kind
+            std::pair<llvm::StringRef, llvm::StringRef> method = line.split(' ');
+            name = method.first;
+            kind = method.second.trim();
+        }
+        
+        if (name.empty() || name.find(' ') != llvm::StringRef::npos) {
+            error = "line " + std::to_string(lineNumber) + ": malformed selector";
+            return false;
+        }
+        
+        if (kind.empty() || kind == "nonnull") {
+            rule.Kind = NullabilityKind::NonNull;
+        } else if (kind == "nullable") {
+            rule.Kind = NullabilityKind::Nullable;
+        } else {
+            error = "line " + std::to_string(lineNumber) + ": unknown nullability " + kind.str();
+            return false;
+        }
+        
+        rule.Selector = name.str();
+        rules.push_back(rule);
+    }
+    
+    _Rules.insert(_Rules.end(), rules.begin(), rules.end());
+    
+    return true;
+}
+
+static Selector internSelector(ASTContext &astContext, llvm::StringRef name) {
+    if (!name.endswith(":")) {
+        return astContext.Selectors.getNullarySelector(&astContext.Idents.get(name));
+    }
+    
+    llvm::SmallVector<llvm::StringRef, 4> pieces;
+    name.drop_back().split(pieces, ":");
+    
+    llvm::SmallVector<IdentifierInfo *, 4> identifiers;
+    for (auto piece : pieces) {
+        // Empty piece is allowed, like `foo::`
+        identifiers.push_back(piece.empty() ? nullptr : &astContext.Idents.get(piece));
+    }
+    
+    return astContext.Selectors.getSelector(identifiers.size(), identifiers.data());
+}
+
+SelectorNullabilityTable::SelectorNullabilityTable(clang::ASTContext &astContext, const SelectorNullabilityRules &rules) {
+    for (auto &rule : rules.getRules()) {
+        const IdentifierInfo *className = rule.ClassName.empty() ? nullptr : &astContext.Idents.get(rule.ClassName);
+        Selector selector = internSelector(astContext, rule.Selector);
+        Key key(className, selector);
+        
+        if (className) {
+            _ClassRuleSelectors.insert(selector);
+        }
+        
+        if (rule.ClassMethod) {
+            _ClassMethods[key] = rule.Kind;
+        } else {
+            _InstanceMethods[key] = rule.Kind;
+        }
+    }
+}
+
+clang::NullabilityKind SelectorNullabilityTable::lookup(const clang::ObjCMessageExpr *messageExpr) const {
+    const llvm::DenseMap<Key, NullabilityKind> &methods = messageExpr->isClassMessage() ? _ClassMethods : _InstanceMethods;
+    Selector selector = messageExpr->getSelector();
+    
+    // Most rules are for any class; superclass chain is walked only for selectors some class has a rule for
+    if (_ClassRuleSelectors.count(selector)) {
+        for (const ObjCInterfaceDecl *interface = messageExpr->getReceiverInterface(); interface; interface = interface->getSuperClass()) {
+            auto it = methods.find(Key(interface->getIdentifier(), selector));
+            if (it != methods.end()) {
+                return it->second;
+            }
+        }
+    }
+    
+    auto it = methods.find(Key(nullptr, selector));
+    if (it != methods.end()) {
+        return it->second;
+    }
+    
+    return NullabilityKind::Unspecified;
+}
@@ -0,0 +1,73 @@
+#ifndef SelectorNullabilityTable_h
+#define SelectorNullabilityTable_h
+
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <clang/AST/AST.h>
+
+/**
+ Nullability of result of methods with the selector, declared by class name (or any class if empty).
+ */
+struct SelectorNullabilityRule {
+    bool ClassMethod;
+    std::string ClassName;
+    std::string Selector;
+    clang::NullabilityKind Kind;
+};
+
+/**
+ Rules of selector nullability independent from translation units.
+ Builtin rules (-class, -init, -alloc, +class, +alloc, +new are nonnull) are included, and more rules can be loaded from files.
+ 
+ Each line of the file is a rule, and `#` starts a comment:
+ 
+     -objectEnumerator            # instance method of any class
+     +sharedInstance nonnull      # class method of any class
+     -[LegacyStore itemForKey:] nullable
+ */
+class SelectorNullabilityRules {
+    std::vector<SelectorNullabilityRule> _Rules;
+    
+public:
+    explicit SelectorNullabilityRules();
+    
+    /**
+     Returns false and sets error if file cannot be read or has a malformed line.
+     */
+    bool loadFile(const std::string &path, std::string &error);
+    
+    /**
+     Rules are added only if all of the lines are valid.
+     */
+    bool parse(llvm::StringRef text, std::string &error);
+    
+    const std::vector<SelectorNullabilityRule> &getRules() const {
+        return _Rules;
+    }
+};
+
+/**
+ Rules interned into selectors of a translation unit.
+ It gives nullability of message sends whose method declaration does not have nullability.
+ */
+class SelectorNullabilityTable {
+    typedef std::pair<const clang::IdentifierInfo *, clang::Selector> Key;
+    
+    llvm::DenseMap<Key, clang::NullabilityKind> _InstanceMethods;
+    llvm::DenseMap<Key, clang::NullabilityKind> _ClassMethods;
+    llvm::DenseSet<clang::Selector> _ClassRuleSelectors;
+    
+public:
+    explicit SelectorNullabilityTable(clang::ASTContext &astContext, const SelectorNullabilityRules &rules);
+    
+    /**
+     Returns Unspecified if no rule is given for the message.
+     Rules for receiver class and its superclasses are tested only if a class has a rule for the selector.
+     */
+    clang::NullabilityKind lookup(const clang::ObjCMessageExpr *messageExpr) const;
+};
+
+#endif
@@ -3,31 +3,16 @@
 using namespace clang;
 
 class VariableNullabilityPropagationVisitor : public RecursiveASTVisitor<VariableNullabilityPropagationVisitor> {
-    ExpressionNullabilityCalculator &_NullabilityCalculator;
-    std::shared_ptr<VariableNullabilityEnvironment> _VarEnv;
+    VariableNullabilityPropagation &_Propagation;
 
 public:
-    explicit VariableNullabilityPropagationVisitor(ExpressionNullabilityCalculator &nullabilityCalculator,
-                                                   std::shared_ptr<VariableNullabilityEnvironment> varEnv)
-    : RecursiveASTVisitor(), _NullabilityCalculator(nullabilityCalculator), _VarEnv(varEnv) {
+    explicit VariableNullabilityPropagationVisitor(VariableNullabilityPropagation &propagation)
+    : RecursiveASTVisitor(), _Propagation(propagation) {
         
     }
     
     bool VisitVarDecl(VarDecl *decl) {
-        const Type *type = decl->getType().getTypePtr();
-        auto nullability = type->getNullability(_NullabilityCalculator.getASTContext());
-        
-        if (isPointerType(type)) {
-            if (!nullability.hasValue()) {
-                auto init = decl->getInit();
-                if (init && !llvm::isa<ImplicitValueInitExpr>(init)) {
-                    ExpressionNullability n = _NullabilityCalculator.calculate(decl->getInit());
-                    auto kind = n.getNullability();
-                    _VarEnv->set(decl, type, kind);
-                }
-            }
-        }
-        
+        _Propagation.propagate(decl);
         return true;
     }
     
@@ -37,33 +22,47 @@ public:
     }
 
     bool TraverseObjCForCollectionStmt(ObjCForCollectionStmt *stmt) {
-        auto decl = llvm::dyn_cast<DeclStmt>(stmt->getElement());
-        if (decl) {
-            for (auto it : decl->getDeclGroup()) {
-                auto varDecl = llvm::dyn_cast<VarDecl>(it);
-                if (varDecl) {
-                    auto type = varDecl->getType().getTypePtr();
-                    
-                    if (isPointerType(type)) {
-                        Optional<NullabilityKind> kind = type->getNullability(_NullabilityCalculator.getASTContext());
-                        if (!kind.hasValue()) {
-                            _VarEnv->set(varDecl, type, NullabilityKind::NonNull);
-                        }
-                    }
-                }
-            }
-        }
-        
+        _Propagation.propagate(stmt);
         return TraverseStmt(stmt->getBody());
     }
 };
 
 void VariableNullabilityPropagation::propagate(clang::ObjCMethodDecl *methodDecl) {
-    VariableNullabilityPropagationVisitor visitor(_NullabilityCalculator, _VarEnv);
+    VariableNullabilityPropagationVisitor visitor(*this);
     visitor.TraverseStmt(methodDecl->getBody());
 }
 
-void VariableNullabilityPropagation::propagate(clang::BlockExpr *blockExpr) {
-    VariableNullabilityPropagationVisitor visitor(_NullabilityCalculator, _VarEnv);
-    visitor.TraverseStmt(blockExpr->getBody());
+void VariableNullabilityPropagation::propagate(const clang::VarDecl *decl) {
+    const Type *type = decl->getType().getTypePtr();
+    
+    if (isPointerType(type)) {
+        auto nullability = type->getNullability(_NullabilityCalculator.getASTContext());
+        if (!nullability.hasValue()) {
+            auto init = decl->getInit();
+            if (init && !llvm::isa<ImplicitValueInitExpr>(init)) {
+                ExpressionNullability n = _NullabilityCalculator.calculate(init);
+                auto kind = n.getNullability();
+                _VarEnv->set(decl, type, kind);
+            }
+        }
+    }
+}
+
+void VariableNullabilityPropagation::propagate(const clang::ObjCForCollectionStmt *stmt) {
+    auto decl = llvm::dyn_cast<DeclStmt>(stmt->getElement());
+    if (decl) {
+        for (auto it : decl->getDeclGroup()) {
+            auto varDecl = llvm::dyn_cast<VarDecl>(it);
+            if (varDecl) {
+                auto type = varDecl->getType().getTypePtr();
+                
+                if (isPointerType(type)) {
+                    Optional<NullabilityKind> kind = type->getNullability(_NullabilityCalculator.getASTContext());
+                    if (!kind.hasValue()) {
+                        _VarEnv->set(varDecl, type, NullabilityKind::NonNull);
+                    }
+                }
+            }
+        }
+    }
 }
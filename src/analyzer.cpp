@@ -3,13 +3,17 @@
 #include <stack>
 #include <unordered_map>
 #include <sstream>
+#include <mutex>
+#include <atomic>
 
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/StmtVisitor.h>
 #include <clang/AST/RecursiveASTVisitor.h>
+#include <llvm/Support/ThreadPool.h>
 
 #include "analyzer.h"
 #include "InitializerChecker.h"
+#include "NullabilityFlowAnalysis.h"
 
 using namespace llvm;
 using namespace clang;
@@ -26,37 +30,17 @@ std::set<const clang::ObjCContainerDecl *> MethodUtility::enumerateContainers(co
             const ObjCObjectPointerType *objectPointerType = receiverType->getAsObjCInterfacePointerType();
             if (objectPointerType) {
                 const ObjCInterfaceDecl *interface = objectPointerType->getInterfaceDecl();
-    
-                while (interface) {
-                    if (interface->getInstanceMethod(selector)) {
-                        set.insert(interface);
-                        interface = nullptr; // break
-                    } else {
-                        for (auto protocol : interface->protocols()) {
-                            if (protocol->getInstanceMethod(selector)) {
-                                set.insert(protocol);
-                                interface = nullptr; //break
-                            }
-                        }
-                    }
-                    
-                    if (interface) {
-                        interface = interface->getSuperClass();
-                    }
+                if (interface) {
+                    auto &containers = lookupContainers(interface, selector);
+                    set.insert(containers.begin(), containers.end());
                 }
             }
             
             if (receiverType->isObjCQualifiedIdType()) {
                 const ObjCObjectPointerType *pointerType = receiverType->getAsObjCQualifiedIdType();
                 
-                auto protocols = pointerType->getNumProtocols();
-                for (unsigned index = 0; index < protocols; index++) {
-                    auto protocol = pointerType->getProtocol(index);
-                    
-                    if (protocol->getInstanceMethod(selector)) {
-                        set.insert(protocol);
-                    }
-                }
+                auto &containers = lookupContainers(pointerType, selector);
+                set.insert(containers.begin(), containers.end());
             }
         }
     }
@@ -71,6 +55,115 @@ std::set<const clang::ObjCContainerDecl *> MethodUtility::enumerateContainers(co
     return set;
 }
 
+const std::vector<const clang::ObjCContainerDecl *> &MethodUtility::lookupContainers(const clang::ObjCInterfaceDecl *interface, const clang::Selector selector) {
+    ContainerLookupKey key(interface->getTypeForDecl(), selector);
+    
+    auto it = _ContainersCache.find(key);
+    if (it != _ContainersCache.end()) {
+        return it->second;
+    }
+    
+    std::vector<const ObjCContainerDecl *> containers;
+    
+    while (interface) {
+        if (interface->getInstanceMethod(selector)) {
+            containers.push_back(interface);
+            interface = nullptr; // break
+        } else {
+            for (auto protocol : interface->protocols()) {
+                if (protocol->getInstanceMethod(selector)) {
+                    containers.push_back(protocol);
+                    interface = nullptr; //break
+                }
+            }
+        }
+        
+        if (interface) {
+            interface = interface->getSuperClass();
+        }
+    }
+    
+    return _ContainersCache[key] = std::move(containers);
+}
+
+const std::vector<const clang::ObjCContainerDecl *> &MethodUtility::lookupContainers(const clang::ObjCObjectPointerType *qualifiedIdType, const clang::Selector selector) {
+    ContainerLookupKey key(qualifiedIdType->getCanonicalTypeInternal().getTypePtr(), selector);
+    
+    auto it = _ContainersCache.find(key);
+    if (it != _ContainersCache.end()) {
+        return it->second;
+    }
+    
+    std::vector<const ObjCContainerDecl *> containers;
+    
+    auto protocols = qualifiedIdType->getNumProtocols();
+    for (unsigned index = 0; index < protocols; index++) {
+        auto protocol = qualifiedIdType->getProtocol(index);
+        
+        if (protocol->getInstanceMethod(selector)) {
+            containers.push_back(protocol);
+        }
+    }
+    
+    return _ContainersCache[key] = std::move(containers);
+}
+
+ObjCContainerDecl *MethodUtility::interfaceForSelector(const Expr *receiver, const Selector selector) {
+    const ObjCObjectPointerType *pointerType = llvm::dyn_cast<ObjCObjectPointerType>(receiver->getType().getTypePtr()->getUnqualifiedDesugaredType());
+    if (!pointerType) {
+        return nullptr;
+    }
+    
+    ObjCInterfaceDecl *decl = pointerType->getInterfaceDecl();
+    
+    ContainerLookupKey key(decl ? decl->getTypeForDecl() : pointerType->getCanonicalTypeInternal().getTypePtr(), selector);
+    
+    auto it = _InterfaceCache.find(key);
+    if (it != _InterfaceCache.end()) {
+        return it->second;
+    }
+    
+    ObjCContainerDecl *container = nullptr;
+    
+    if (decl) {
+        // SomeClass *
+        while (decl && !container) {
+            ObjCMethodDecl *method = decl->getMethod(selector, true);
+            if (method) {
+                container = decl;
+                break;
+            }
+            
+            for (auto it = decl->protocol_begin(); it != decl->protocol_end(); it++) {
+                ObjCProtocolDecl *protocol = *it;
+                method = protocol->lookupMethod(selector, true);
+                if (method) {
+                    container = decl;
+                    break;
+                }
+            }
+            
+            if (!container) {
+                decl = decl->getSuperClass();
+            }
+        }
+    } else {
+        // id<Protocol>
+        unsigned protocols = pointerType->getNumProtocols();
+        
+        for (unsigned index = 0; index < protocols; index++) {
+            ObjCProtocolDecl *protocol = pointerType->getProtocol(index);
+            ObjCMethodDecl *method = protocol->lookupMethod(selector, true);
+            if (method) {
+                container = protocol;
+                break;
+            }
+        }
+    }
+    
+    return _InterfaceCache[key] = container;
+}
+
 QualType NullabilityCheckContext::getReturnType() const {
     if (BlockExpr) {
         const Type *type = BlockExpr->getType().getTypePtr();
@@ -83,76 +176,183 @@ QualType NullabilityCheckContext::getReturnType() const {
     }
 }
 
-class NullCheckVisitor : public RecursiveASTVisitor<NullCheckVisitor> {
+/**
+ Finds message sends in a method body whose containers pass the filter.
+ Subjects of warnings are the class of the method and containers of message sends in the body, including blocks.
+ */
+class FilterRelevanceScanner : public RecursiveASTVisitor<FilterRelevanceScanner> {
+    Filter &_Filter;
+    MethodUtility &_MethodUtility;
+    bool _Relevant;
+    
 public:
-    NullCheckVisitor(ASTContext &context, bool debug, Filter &filter) : _ASTContext(context), _Debug(debug), _Filter(filter) {}
-
-    bool VisitDecl(Decl *decl) {
-        ObjCMethodDecl *methodDecl = llvm::dyn_cast<ObjCMethodDecl>(decl);
-        if (methodDecl) {
-            if (methodDecl->hasBody()) {
-                auto map = std::shared_ptr<VariableNullabilityMapping>(new VariableNullabilityMapping);
-                
-                std::shared_ptr<VariableNullabilityEnvironment> varEnv(new VariableNullabilityEnvironment(_ASTContext, map));
-                ExpressionNullabilityCalculator nullabilityCalculator(_ASTContext, varEnv);
-                VariableNullabilityPropagation propagation(nullabilityCalculator, varEnv);
-                
-                propagation.propagate(methodDecl);
-
-                if (_Debug) {
-                    for (auto it : *map) {
-                        const VarDecl *decl = it.first;
-                        NullabilityKind kind = it.second.getNullability();
-                        
-                        std::string x = "";
-                        switch (kind) {
-                            case NullabilityKind::Unspecified:
-                                x = "unspecified";
-                                break;
-                            case NullabilityKind::NonNull:
-                                x = "nonnull";
-                                break;
-                            case NullabilityKind::Nullable:
-                                x = "nullable";
-                                break;
-                        }
-                        
-                        DiagnosticsEngine &engine = _ASTContext.getDiagnostics();
-                        unsigned id = engine.getCustomDiagID(DiagnosticsEngine::Remark, "Variable nullability: %0");
-                        engine.Report(decl->getLocation(), id) << x;
-                    }
-                }
-                
-                NullabilityCheckContext checkContext(*(methodDecl->getClassInterface()), *methodDecl);
-
-                MethodBodyChecker checker(_ASTContext, checkContext, nullabilityCalculator, varEnv, _Filter);
-                checker.TraverseStmt(methodDecl->getBody());
+    FilterRelevanceScanner(Filter &filter, MethodUtility &utility) : _Filter(filter), _MethodUtility(utility), _Relevant(false) {}
+    
+    bool VisitObjCMessageExpr(ObjCMessageExpr *expr) {
+        for (auto container : _MethodUtility.enumerateContainers(expr)) {
+            if (_Filter.testClassName(container->getName())) {
+                _Relevant = true;
+                // Stop traversal
+                return false;
             }
         }
         
         return true;
     }
+    
+    bool isRelevant() const {
+        return _Relevant;
+    }
+};
 
-private:
-    ASTContext &_ASTContext;
-    bool _Debug;
-    Filter &_Filter;
+/**
+ Unit of work in a translation unit: a method body, or initializers of a class implementation if MethodDecl is null.
+ */
+struct ImplementationCheckTask {
+    ObjCImplDecl *ImplDecl;
+    ObjCMethodDecl *MethodDecl;
 };
 
-class InitializerCheckerVisitor : public RecursiveASTVisitor<InitializerCheckerVisitor> {
+/**
+ Checks methods in an implementation, and initializers if it is a class implementation.
+ */
+class ImplementationChecker {
+public:
+    ImplementationChecker(ASTContext &context, bool debug, Filter &filter, const SelectorNullabilityTable &selectorTable, NullabilityDiagnosticCatalog &diagnostics, const NullabilityCheckSet &checks)
+    : _ASTContext(context), _Debug(debug), _Filter(filter), _SelectorTable(selectorTable), _Diagnostics(diagnostics), _Checks(checks),
+      _SignatureCache(context, checks.isEnabled(NullabilityCheck::BlockType)), _ASTMutex(nullptr) {}
+    
+    /**
+     Appends checks of the implementation to tasks, in the order they are done in serial run.
+     */
+    static void enumerateTasks(ObjCImplDecl *implDecl, std::vector<ImplementationCheckTask> &tasks) {
+        for (auto methodDecl : implDecl->methods()) {
+            if (methodDecl->hasBody()) {
+                tasks.push_back(ImplementationCheckTask{ implDecl, methodDecl });
+            }
+        }
+        
+        if (llvm::isa<ObjCImplementationDecl>(implDecl)) {
+            tasks.push_back(ImplementationCheckTask{ implDecl, nullptr });
+        }
+    }
+    
+    void check(const ImplementationCheckTask &task) {
+        if (task.MethodDecl) {
+            if (mayReportWarning(task.MethodDecl)) {
+                checkMethodBody(task.MethodDecl);
+            }
+        } else if (_Checks.isEnabled(NullabilityCheck::Initializer)) {
+            checkInitializers(llvm::cast<ObjCImplementationDecl>(task.ImplDecl));
+        }
+    }
+    
+    /**
+     Set when checkers run in parallel; CFG construction may update ASTContext (for constant evaluation), and is done while locking the mutex.
+     */
+    void setASTMutex(std::mutex *mutex) {
+        _ASTMutex = mutex;
+    }
+
+private:
     ASTContext &_ASTContext;
     bool _Debug;
     Filter &_Filter;
+    const SelectorNullabilityTable &_SelectorTable;
+    NullabilityDiagnosticCatalog &_Diagnostics;
+    const NullabilityCheckSet &_Checks;
+    MethodUtility _MethodUtility;
+    NullabilitySignatureCache _SignatureCache;
+    llvm::BumpPtrAllocator _MethodAllocator;
+    InitializerMethodCache _InitializerMethods;
+    std::mutex *_ASTMutex;
     
-public:
-    InitializerCheckerVisitor(ASTContext &astContext, bool debug, Filter &filter) : _ASTContext(astContext), _Debug(debug), _Filter(filter) {}
+    /**
+     Returns false if no warning in the method can pass the filter, so that analysis of the method can be skipped.
+     */
+    bool mayReportWarning(ObjCMethodDecl *methodDecl) {
+        if (_Filter.isEmpty()) {
+            return true;
+        }
+        
+        if (_Filter.testClassName(methodDecl->getClassInterface()->getName())) {
+            return true;
+        }
+        
+        FilterRelevanceScanner scanner(_Filter, _MethodUtility);
+        scanner.TraverseStmt(methodDecl->getBody());
+        
+        return scanner.isRelevant();
+    }
     
-    bool TraverseObjCImplementationDecl(ObjCImplementationDecl *decl) {
-        InitializerChecker checker(_ASTContext, decl);
+    void checkMethodBody(ObjCMethodDecl *methodDecl) {
+        auto map = std::shared_ptr<VariableNullabilityMapping>(new VariableNullabilityMapping);
+        
+        std::unique_lock<std::mutex> cfgLock;
+        if (_ASTMutex) {
+            cfgLock = std::unique_lock<std::mutex>(*_ASTMutex);
+        }
+        
+        NullabilityFlowAnalysis flowAnalysis(_ASTContext, methodDecl);
+        
+        if (cfgLock.owns_lock()) {
+            cfgLock.unlock();
+        }
+        
+        std::shared_ptr<VariableNullabilityEnvironment> varEnv(new VariableNullabilityEnvironment(_ASTContext, map));
+        ExpressionNullabilityCalculator nullabilityCalculator(_ASTContext, varEnv, &flowAnalysis, &_SelectorTable);
+        
+        NullabilityDependencyCalculator dependencyCalculator(_ASTContext, methodDecl, _MethodAllocator);
+        NullabilityCheckContext checkContext(*(methodDecl->getClassInterface()), *methodDecl, dependencyCalculator, _MethodUtility, _SignatureCache, _Diagnostics, _Checks);
+
+        // Propagates variable nullability while checking
+        MethodBodyChecker checker(_ASTContext, checkContext, nullabilityCalculator, varEnv, _Filter);
+        checker.TraverseStmt(methodDecl->getBody());
+
+        if (_Debug) {
+            for (auto it : *map) {
+                const VarDecl *decl = it.first;
+                NullabilityKind kind = it.second.getNullability();
+                
+                std::string x = "";
+                switch (kind) {
+                    case NullabilityKind::Unspecified:
+                        x = "unspecified";
+                        break;
+                    case NullabilityKind::NonNull:
+                        x = "nonnull";
+                        break;
+                    case NullabilityKind::Nullable:
+                        x = "nullable";
+                        break;
+                }
+                
+                _Diagnostics.report(decl->getLocation(), NullabilityDiagnostic::VariableNullability) << x;
+            }
+        }
+        
+        // Temporaries of the method are not used after the check
+        _MethodAllocator.Reset();
+    }
+    
+    void checkInitializers(ObjCImplementationDecl *decl) {
+        // Most classes have no annotated initializer; find them before building ivar table of the class
+        std::vector<ObjCMethodDecl *> initializers;
+        for (auto methodDecl : decl->methods()) {
+            if (_InitializerMethods.isInitializerMethod(methodDecl)) {
+                initializers.push_back(methodDecl);
+            }
+        }
+        
+        if (initializers.empty()) {
+            return;
+        }
         
         std::set<std::string> subject{ decl->getNameAsString() };
         if (_Filter.testClassName(subject)) {
-            for (auto methodDecl : decl->methods()) {
+            InitializerChecker checker(_ASTContext, decl, _InitializerMethods);
+            
+            for (auto methodDecl : initializers) {
                 auto uninitializedVars = checker.check(methodDecl);
                 
                 if (!uninitializedVars.empty()) {
@@ -167,38 +367,211 @@ public:
                         names << info->getIvarDecl()->getNameAsString();
                     }
                     
-                    DiagnosticsEngine &engine = _ASTContext.getDiagnostics();
-                    unsigned id = engine.getCustomDiagID(DiagnosticsEngine::Warning, "Nonnull ivar should be initialized: %0");
-                    engine.Report(methodDecl->getLocation(), id) << names.str();
+                    _Diagnostics.report(methodDecl->getLocation(), NullabilityDiagnostic::UninitializedIvar) << names.str();
                 }
             }
         }
-        
-        return true;
+    }
+};
+
+/**
+ Keeps diagnostics to report them later to another engine.
+ */
+class StoredDiagnosticBuffer : public DiagnosticConsumer {
+    std::vector<StoredDiagnostic> _Diagnostics;
+    
+public:
+    void HandleDiagnostic(DiagnosticsEngine::Level level, const Diagnostic &info) override {
+        DiagnosticConsumer::HandleDiagnostic(level, info);
+        _Diagnostics.push_back(StoredDiagnostic(level, info));
+    }
+    
+    std::vector<StoredDiagnostic> takeDiagnostics() {
+        std::vector<StoredDiagnostic> diagnostics;
+        diagnostics.swap(_Diagnostics);
+        return diagnostics;
+    }
+};
+
+/**
+ Checker for one thread, with its own caches and diagnostics engine.
+ The engine shares diagnostic IDs with the translation unit's engine, so that stored diagnostics can be reported to it.
+ */
+class ImplementationCheckWorker {
+    StoredDiagnosticBuffer _Buffer;
+    DiagnosticsEngine _Engine;
+    NullabilityDiagnosticCatalog _Diagnostics;
+    ImplementationChecker _Checker;
+    
+public:
+    ImplementationCheckWorker(ASTContext &context, bool debug, Filter &filter, const SelectorNullabilityTable &selectorTable, const NullabilityCheckSet &checks, std::mutex &astMutex)
+    : _Engine(context.getDiagnostics().getDiagnosticIDs(), &context.getDiagnostics().getDiagnosticOptions(), &_Buffer, false),
+      _Diagnostics(_Engine), _Checker(context, debug, filter, selectorTable, _Diagnostics, checks) {
+        _Engine.setSourceManager(&context.getSourceManager());
+        _Checker.setASTMutex(&astMutex);
+    }
+    
+    std::vector<StoredDiagnostic> check(const ImplementationCheckTask &task) {
+        _Checker.check(task);
+        return _Buffer.takeDiagnostics();
     }
 };
 
 class NullCheckConsumer : public ASTConsumer {
 public:
-    explicit NullCheckConsumer(bool debug, Filter &filter) : ASTConsumer(), _Debug(debug), _Filter(filter) {
+    explicit NullCheckConsumer(bool debug, Filter &filter, std::set<const FileEntry *> files, const SelectorNullabilityRules &selectorRules, const NullabilityCheckSet &checks, unsigned jobs)
+    : ASTConsumer(), _Debug(debug), _Filter(filter), _Files(files), _SelectorRules(selectorRules), _Checks(checks), _Jobs(jobs) {
     }
     
     virtual void HandleTranslationUnit(clang::ASTContext &Context) {
-        NullCheckVisitor visitor(Context, _Debug, _Filter);
-        visitor.TraverseDecl(Context.getTranslationUnitDecl());
+        SelectorNullabilityTable selectorTable(Context, _SelectorRules);
+        
+        std::vector<ImplementationCheckTask> tasks;
+        enumerateTasks(Context, Context.getTranslationUnitDecl(), tasks);
         
-        InitializerCheckerVisitor initializerCheckerVisitor(Context, _Debug, _Filter);
-        initializerCheckerVisitor.TraverseDecl(Context.getTranslationUnitDecl());
+        if (canCheckInParallel(Context, tasks)) {
+            checkInParallel(Context, selectorTable, tasks);
+        } else {
+            NullabilityDiagnosticCatalog diagnostics(Context.getDiagnostics());
+            ImplementationChecker checker(Context, _Debug, _Filter, selectorTable, diagnostics, _Checks);
+            
+            for (auto &task : tasks) {
+                checker.check(task);
+            }
+        }
     }
     
 private:
     bool _Debug;
     Filter &_Filter;
+    std::set<const FileEntry *> _Files;
+    const SelectorNullabilityRules &_SelectorRules;
+    const NullabilityCheckSet &_Checks;
+    unsigned _Jobs;
+    
+    /**
+     Implementations are top level declarations; declarations in headers are skipped without traversing their members.
+     */
+    void enumerateTasks(ASTContext &context, const DeclContext *declContext, std::vector<ImplementationCheckTask> &tasks) {
+        for (auto decl : declContext->decls()) {
+            if (auto linkageSpec = llvm::dyn_cast<LinkageSpecDecl>(decl)) {
+                enumerateTasks(context, linkageSpec, tasks);
+                continue;
+            }
+            
+            auto implDecl = llvm::dyn_cast<ObjCImplDecl>(decl);
+            if (implDecl && isCheckTarget(context.getSourceManager(), implDecl->getLocation())) {
+                ImplementationChecker::enumerateTasks(implDecl, tasks);
+            }
+        }
+    }
+    
+    bool isCheckTarget(const SourceManager &sourceManager, SourceLocation location) {
+        if (sourceManager.isInMainFile(location)) {
+            return true;
+        }
+        
+        if (_Files.empty()) {
+            return false;
+        }
+        
+        FileID fileID = sourceManager.getFileID(sourceManager.getExpansionLoc(location));
+        return _Files.find(sourceManager.getFileEntryForID(fileID)) != _Files.end();
+    }
+    
+    bool canCheckInParallel(ASTContext &context, const std::vector<ImplementationCheckTask> &tasks) {
+        if (_Jobs <= 1 || tasks.size() <= 1) {
+            return false;
+        }
+        
+        // Declarations from modules or PCH are deserialized lazily on lookup, which is not thread safe
+        if (context.getExternalSource()) {
+            return false;
+        }
+        
+        // Stored diagnostics are reported without the engine's suppression
+        DiagnosticsEngine &engine = context.getDiagnostics();
+        return !engine.hasFatalErrorOccurred() && !engine.getSuppressAllDiagnostics();
+    }
+    
+    /**
+     Lookup tables of declaration contexts may be built lazily on first lookup; build them before threads share the AST.
+     */
+    void buildLookupTables(const DeclContext *declContext) {
+        for (auto decl : declContext->decls()) {
+            if (auto linkageSpec = llvm::dyn_cast<LinkageSpecDecl>(decl)) {
+                buildLookupTables(linkageSpec);
+            } else if (auto container = llvm::dyn_cast<ObjCContainerDecl>(decl)) {
+                container->lookup(DeclarationName());
+            }
+        }
+    }
+    
+    /**
+     Tasks are taken by workers one by one, so that a long method does not keep other workers waiting for a fixed share.
+     Diagnostics of each task are stored, and reported in order of tasks after all tasks are done; the output is the same as serial run.
+     */
+    void checkInParallel(ASTContext &context, const SelectorNullabilityTable &selectorTable, const std::vector<ImplementationCheckTask> &tasks) {
+        buildLookupTables(context.getTranslationUnitDecl());
+        
+        std::mutex astMutex;
+        unsigned numWorkers = std::min<size_t>(_Jobs, tasks.size());
+        
+        // Engines are created (and diagnostics registered) before any thread starts
+        std::vector<std::unique_ptr<ImplementationCheckWorker>> workers;
+        for (unsigned i = 0; i < numWorkers; i++) {
+            workers.emplace_back(new ImplementationCheckWorker(context, _Debug, _Filter, selectorTable, _Checks, astMutex));
+        }
+        
+        std::vector<std::vector<StoredDiagnostic>> results(tasks.size());
+        std::atomic<size_t> nextTask(0);
+        
+        {
+            ThreadPool pool(numWorkers);
+            
+            for (auto &worker : workers) {
+                ImplementationCheckWorker *w = worker.get();
+                pool.async([&, w] {
+                    for (size_t index = nextTask++; index < tasks.size(); index = nextTask++) {
+                        results[index] = w->check(tasks[index]);
+                    }
+                });
+            }
+            
+            pool.wait();
+        }
+        
+        DiagnosticsEngine &engine = context.getDiagnostics();
+        for (auto &diagnostics : results) {
+            for (auto &diagnostic : diagnostics) {
+                engine.Report(diagnostic);
+            }
+        }
+    }
 };
 
 std::unique_ptr<clang::ASTConsumer> NullCheckAction::CreateASTConsumer(CompilerInstance &Compiler, StringRef InFile) {
-    return std::unique_ptr<ASTConsumer>(new NullCheckConsumer(Debug, _Filter));
+    std::set<const FileEntry *> files;
+    
+    for (auto &path : _CheckedFiles) {
+        const FileEntry *entry = Compiler.getFileManager().getFile(path);
+        if (entry) {
+            files.insert(entry);
+        }
+    }
+    
+    return std::unique_ptr<ASTConsumer>(new NullCheckConsumer(Debug, *_Filter, files, _SelectorRules, _Checks, _MethodJobs));
 }
 
-
-
+std::unique_ptr<NullCheckAction> NullCheckAction::clone() const {
+    std::unique_ptr<NullCheckAction> action(new NullCheckAction);
+    
+    action->Debug = Debug;
+    action->_Filter = _Filter;
+    action->_CheckedFiles = _CheckedFiles;
+    action->_SelectorRules = _SelectorRules;
+    action->_Checks = _Checks;
+    action->_MethodJobs = _MethodJobs;
+    
+    return action;
+}
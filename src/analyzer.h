@@ -3,33 +3,60 @@
 
 #include <unordered_map>
 #include <set>
+#include <vector>
 
+#include <llvm/ADT/DenseMap.h>
 #include <clang/Frontend/FrontendActions.h>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/AST/StmtVisitor.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 
 #include "ExpressionNullabilityCalculator.h"
+#include "NullabilityDependencyCalculator.h"
+#include "NullabilitySignature.h"
+#include "SelectorNullabilityTable.h"
 #include "FilteringClause.h"
+#include "NullabilityDiagnostics.h"
 
 using namespace clang;
 
+/**
+ Key for container lookup: the receiver (interface type or canonical qualified id type) and the selector.
+ */
+typedef std::pair<const clang::Type *, clang::Selector> ContainerLookupKey;
+
+/**
+ Resolves containers which declare the method of message send.
+ Lookup results are cached, so one instance is expected to be shared in a translation unit.
+ */
 class MethodUtility {
+    llvm::DenseMap<ContainerLookupKey, std::vector<const clang::ObjCContainerDecl *>> _ContainersCache;
+    llvm::DenseMap<ContainerLookupKey, clang::ObjCContainerDecl *> _InterfaceCache;
+    
+    const std::vector<const clang::ObjCContainerDecl *> &lookupContainers(const clang::ObjCInterfaceDecl *interface, const clang::Selector selector);
+    const std::vector<const clang::ObjCContainerDecl *> &lookupContainers(const clang::ObjCObjectPointerType *qualifiedIdType, const clang::Selector selector);
+    
 public:
     std::set<const clang::ObjCContainerDecl *> enumerateContainers(const clang::ObjCMessageExpr *expr);
+    clang::ObjCContainerDecl *interfaceForSelector(const clang::Expr *receiver, const clang::Selector selector);
 };
 
 class NullabilityCheckContext {
     const ObjCInterfaceDecl &InterfaceDecl;
     const ObjCMethodDecl &MethodDecl;
+    NullabilityDependencyCalculator &DependencyCalculator;
+    MethodUtility &Utility;
+    NullabilitySignatureCache &SignatureCache;
+    NullabilityDiagnosticCatalog &Diagnostics;
+    const NullabilityCheckSet &Checks;
     const BlockExpr *BlockExpr;
     
 public:
-    NullabilityCheckContext(const ObjCInterfaceDecl &interfaceDecl, const ObjCMethodDecl &methodDecl, const clang::BlockExpr *blockExpr)
-        : InterfaceDecl(interfaceDecl), MethodDecl(methodDecl), BlockExpr(blockExpr) {}
+    NullabilityCheckContext(const ObjCInterfaceDecl &interfaceDecl, const ObjCMethodDecl &methodDecl, NullabilityDependencyCalculator &dependencyCalculator, MethodUtility &utility, NullabilitySignatureCache &signatureCache, NullabilityDiagnosticCatalog &diagnostics, const NullabilityCheckSet &checks, const clang::BlockExpr *blockExpr)
+        : InterfaceDecl(interfaceDecl), MethodDecl(methodDecl), DependencyCalculator(dependencyCalculator), Utility(utility), SignatureCache(signatureCache), Diagnostics(diagnostics), Checks(checks), BlockExpr(blockExpr) {}
     
-    NullabilityCheckContext(const ObjCInterfaceDecl &interfaceDecl, const ObjCMethodDecl &methodDecl)
-        : InterfaceDecl(interfaceDecl), MethodDecl(methodDecl), BlockExpr(nullptr) {}
+    NullabilityCheckContext(const ObjCInterfaceDecl &interfaceDecl, const ObjCMethodDecl &methodDecl, NullabilityDependencyCalculator &dependencyCalculator, MethodUtility &utility, NullabilitySignatureCache &signatureCache, NullabilityDiagnosticCatalog &diagnostics, const NullabilityCheckSet &checks)
+        : InterfaceDecl(interfaceDecl), MethodDecl(methodDecl), DependencyCalculator(dependencyCalculator), Utility(utility), SignatureCache(signatureCache), Diagnostics(diagnostics), Checks(checks), BlockExpr(nullptr) {}
     
     const ObjCInterfaceDecl &getInterfaceDecl() const {
         return InterfaceDecl;
@@ -43,23 +70,65 @@ public:
         return BlockExpr;
     }
     
+    /**
+     Dependency calculator shared by all checks in the method, including blocks in the method.
+     */
+    NullabilityDependencyCalculator &getDependencyCalculator() const {
+        return DependencyCalculator;
+    }
+    
+    /**
+     Method utility shared in the translation unit.
+     */
+    MethodUtility &getMethodUtility() const {
+        return Utility;
+    }
+    
+    /**
+     Method signatures and compatibility results shared in the translation unit.
+     */
+    NullabilitySignatureCache &getSignatureCache() const {
+        return SignatureCache;
+    }
+    
+    /**
+     Diagnostics registered once in the translation unit.
+     */
+    NullabilityDiagnosticCatalog &getDiagnostics() const {
+        return Diagnostics;
+    }
+    
+    bool isCheckEnabled(NullabilityCheck check) const {
+        return Checks.isEnabled(check);
+    }
+    
     QualType getReturnType() const;
     
     NullabilityCheckContext newContextForBlock(const clang::BlockExpr *blockExpr) {
-        return NullabilityCheckContext(InterfaceDecl, MethodDecl, blockExpr);
+        return NullabilityCheckContext(InterfaceDecl, MethodDecl, DependencyCalculator, Utility, SignatureCache, Diagnostics, Checks, blockExpr);
     }
 };
 
-class MethodBodyChecker : public RecursiveASTVisitor<MethodBodyChecker> {
-protected:
+/**
+ Checks statements in a method body (or a block body).
+ Hooks are resolved statically by RecursiveASTVisitor; they are intentionally not virtual.
+ */
+class MethodBodyChecker final : public RecursiveASTVisitor<MethodBodyChecker> {
     ASTContext &_ASTContext;
     NullabilityCheckContext &_CheckContext;
     ExpressionNullabilityCalculator &_NullabilityCalculator;
     std::shared_ptr<VariableNullabilityEnvironment> _VarEnv;
     Filter &_Filter;
+    VariableNullabilityPropagation _Propagation;
+    
+    DiagnosticBuilder WarningReport(SourceLocation location, NullabilityDiagnostic diagnostic, std::set<std::string> &subjects);
+    DiagnosticBuilder WarningReport(SourceLocation location, NullabilityDiagnostic diagnostic, std::set<const clang::ObjCContainerDecl *> &subjects);
     
-    DiagnosticBuilder WarningReport(SourceLocation location, std::set<std::string> &subjects);
-    DiagnosticBuilder WarningReport(SourceLocation location, std::set<const clang::ObjCContainerDecl *> &subjects);
+    /**
+     Report warning whose subjects are dependencies of subjectExpr.
+     Subjects are resolved only when filter has to be tested.
+     */
+    DiagnosticBuilder WarningReport(SourceLocation location, NullabilityDiagnostic diagnostic, const clang::Expr *subjectExpr);
     
 public:
     explicit MethodBodyChecker(ASTContext &astContext,
@@ -67,62 +136,81 @@ public:
                                ExpressionNullabilityCalculator &nullabilityCalculator,
                                std::shared_ptr<VariableNullabilityEnvironment> &env,
                                Filter &filter)
-    : _ASTContext(astContext), _CheckContext(checkContext), _NullabilityCalculator(nullabilityCalculator), _VarEnv(env), _Filter(filter) {}
-    virtual ~MethodBodyChecker() {}
+    : _ASTContext(astContext), _CheckContext(checkContext), _NullabilityCalculator(nullabilityCalculator), _VarEnv(env), _Filter(filter), _Propagation(nullabilityCalculator, env) {}
 
-    virtual bool VisitDeclStmt(DeclStmt *decl);
-    virtual bool VisitObjCMessageExpr(ObjCMessageExpr *callExpr);
-    virtual bool VisitBinAssign(BinaryOperator *assign);
-    virtual bool VisitReturnStmt(ReturnStmt *retStmt);
-    virtual bool VisitObjCArrayLiteral(ObjCArrayLiteral *literal);
-    virtual bool VisitObjCDictionaryLiteral(ObjCDictionaryLiteral *literal);
-    virtual bool TraverseBlockExpr(BlockExpr *blockExpr);
-    virtual bool TraverseIfStmt(IfStmt *ifStmt);
-    virtual bool TraverseBinLAnd(BinaryOperator *land);
-    virtual bool VisitCStyleCastExpr(CStyleCastExpr *expr);
-    virtual bool VisitBinaryConditionalOperator(BinaryConditionalOperator *expr);
-    
-    virtual bool TraverseBinLOr(BinaryOperator *lor) { return RecursiveASTVisitor::TraverseBinLOr(lor); };
-    virtual bool TraverseUnaryLNot(UnaryOperator *lnot) { return RecursiveASTVisitor::TraverseUnaryLNot(lnot); };
-    
-    virtual ObjCContainerDecl *InterfaceForSelector(const Expr *receiver, const Selector selector);
-    virtual std::string MethodNameAsString(const ObjCMessageExpr &messageExpr);
-    virtual std::string MethodCallSubjectAsString(const ObjCMessageExpr &messageExpr);
-    
-    virtual std::set<const ObjCContainerDecl *> subjectDecls(const Expr *expr);
-};
-
-class LAndExprChecker : public MethodBodyChecker {
-public:
-    explicit LAndExprChecker(ASTContext &astContext,
-                             NullabilityCheckContext &checkContext,
-                             ExpressionNullabilityCalculator &nullabilityCalculator,
-                             std::shared_ptr<VariableNullabilityEnvironment> &env,
-                             Filter &filter)
-    : MethodBodyChecker(astContext, checkContext, nullabilityCalculator, env, filter) {}
-
-    virtual bool TraverseBinLAnd(BinaryOperator *land);
-    virtual bool TraverseBinLOr(BinaryOperator *lor);
-    virtual bool TraverseUnaryLNot(UnaryOperator *S);
+    /**
+     Nullability of variables is propagated while traversing the body.
+     Variable declaration updates environment after its initializer is checked.
+     */
+    bool TraverseVarDecl(VarDecl *decl);
+    bool TraverseObjCForCollectionStmt(ObjCForCollectionStmt *stmt);
+    
+    bool VisitVarDecl(VarDecl *decl);
+    bool VisitObjCMessageExpr(ObjCMessageExpr *callExpr);
+    bool VisitBinAssign(BinaryOperator *assign);
+    bool VisitReturnStmt(ReturnStmt *retStmt);
+    bool VisitObjCArrayLiteral(ObjCArrayLiteral *literal);
+    bool VisitObjCDictionaryLiteral(ObjCDictionaryLiteral *literal);
+    bool TraverseBlockExpr(BlockExpr *blockExpr);
+    bool VisitCStyleCastExpr(CStyleCastExpr *expr);
+    bool VisitBinaryConditionalOperator(BinaryConditionalOperator *expr);
+    
+    ObjCContainerDecl *InterfaceForSelector(const Expr *receiver, const Selector selector);
+    std::string MethodNameAsString(const ObjCMessageExpr &messageExpr);
+    std::string MethodCallSubjectAsString(const ObjCMessageExpr &messageExpr);
+    
+    std::set<const ObjCContainerDecl *> subjectDecls(const Expr *expr);
 };
 
 class NullCheckAction : public clang::ASTFrontendAction {
 public:
     virtual std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance &Compiler, clang::StringRef InFile);
     
-    explicit NullCheckAction() : clang::ASTFrontendAction(), Debug(false), _Filter(Filter()) {}
+    explicit NullCheckAction() : clang::ASTFrontendAction(), Debug(false), _Filter(std::make_shared<Filter>()), _MethodJobs(1) {}
+    
+    /**
+     Returns a new action with the same settings, for another translation unit.
+     Filter is shared with the new action.
+     */
+    std::unique_ptr<NullCheckAction> clone() const;
     
     void setDebug(bool debug) {
         Debug = debug;
     }
     
     void addFilterClause(std::shared_ptr<FilteringClause> clause) {
-        _Filter.addClause(clause);
+        _Filter->addClause(clause);
+    }
+    
+    /**
+     Implementations in the file are checked in addition to the main file.
+     */
+    void addCheckedFile(const std::string &path) {
+        _CheckedFiles.push_back(path);
+    }
+    
+    void setSelectorNullabilityRules(const SelectorNullabilityRules &rules) {
+        _SelectorRules = rules;
+    }
+    
+    void setChecks(const NullabilityCheckSet &checks) {
+        _Checks = checks;
+    }
+    
+    /**
+     Methods of a translation unit are checked by the number of threads.
+     */
+    void setMethodJobs(unsigned jobs) {
+        _MethodJobs = jobs;
     }
     
 private:
     bool Debug;
-    Filter _Filter;
+    std::shared_ptr<Filter> _Filter;
+    std::vector<std::string> _CheckedFiles;
+    SelectorNullabilityRules _SelectorRules;
+    NullabilityCheckSet _Checks;
+    unsigned _MethodJobs;
 };
 
 #endif
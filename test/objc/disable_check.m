@@ -0,0 +1,28 @@
+// Option: -disable-check=redundant-cast,redundant-conditional,collection-literal
+
+#import "polyfill.h"
+
+@interface DisableCheck : NSObject
+@end
+
+@implementation DisableCheck
+
+- (void)test1 {
+  NSString * _Nonnull x;
+  NSString * _Nonnull y = (NSString * _Nonnull)x;
+  NSString * _Nonnull z = x ?: @"";
+}
+
+- (void)test2 {
+  NSString * _Nullable x;
+  NSArray *array = @[x];
+  NSDictionary *dict = @{ @"key": x };
+}
+
+- (void)test3 {
+  NSString * _Nullable x;
+  NSNumber *c = (NSNumber * _Nonnull)x; // expected-warning{{Cast on nullability cannot change base type}}
+  NSString * _Nonnull y = x; // expected-warning{{Nullability mismatch on variable declaration}}
+}
+
+@end
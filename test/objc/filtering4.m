@@ -0,0 +1,39 @@
+// Option: -filter Foo
+
+#import "polyfill.h"
+
+@interface Test1 : NSObject
+
+@end
+
+@interface Foo : NSObject
+
+- (NSString *)foo;
+
+@end
+
+@interface Bar : NSObject
+
+- (NSString *)bar;
+
+@end
+
+@implementation Test1 : NSObject
+
+- (void)test1 {
+  Bar * _Nonnull bar = [[Bar alloc] init];
+  NSString * _Nonnull bx;
+
+  bx = [bar bar];
+}
+
+- (void)test2 {
+  void (^block)() = ^{
+    Foo * _Nonnull foo = [[Foo alloc] init];
+    NSString * _Nonnull fx;
+
+    fx = [foo foo]; // expected-warning{{Nullability mismatch on assignment}}
+  };
+}
+
+@end
@@ -0,0 +1,9 @@
+#import "../polyfill.h"
+
+@interface ParallelModuleTest : NSObject
+
+@property (nonatomic, nonnull) NSString *name;
+
+- (nullable NSString *)nickname;
+
+@end
@@ -0,0 +1,27 @@
+// Option: -j=4
+
+#import "modules/ParallelModule.h"
+
+// Declarations come from a module; methods are checked serially, with the same output as without -j
+
+@interface ParallelModuleTest (Checks)
+@end
+
+@implementation ParallelModuleTest (Checks)
+
+- (void)test1 {
+  NSString * _Nonnull x = [self nickname]; // expected-warning{{Nullability mismatch on variable declaration}}
+}
+
+- (void)test2 {
+  self.name = [self nickname]; // expected-warning{{-[ParallelModuleTest setName:] expects nonnull argument}}
+}
+
+- (void)test3 {
+  NSString * _Nullable x = [self nickname];
+  if (x) {
+    self.name = x;
+  }
+}
+
+@end
@@ -0,0 +1,58 @@
+// Option: -j=4
+
+#import "polyfill.h"
+
+@interface ParallelTest : NSObject
+
+@property (nonatomic, nonnull) NSString *name;
+
+@end
+
+@implementation ParallelTest
+
+- (instancetype)initWithName:(NSString * _Nonnull)name __attribute__((annotate("nlh_initializer"))) {
+  self = [super init];
+  _name = name;
+  return self;
+}
+
+- (instancetype)init __attribute__((annotate("nlh_initializer"))) { // expected-warning{{Nonnull ivar should be initialized: _name}}
+  self = [super init];
+  return self;
+}
+
+- (void)test1 {
+  NSString * _Nullable x;
+  NSArray<NSString *> * _Nonnull array = @[x]; // expected-warning{{Array element should be nonnull}}
+}
+
+- (void)test2 {
+  NSString * _Nonnull a;
+  NSString * _Nonnull y = a ?: @""; // expected-warning{{Conditional operator looks redundant}}
+}
+
+- (void)test3 {
+  NSString * _Nullable x;
+  self.name = x; // expected-warning{{-[ParallelTest setName:] expects nonnull argument}}
+}
+
+- (void)test4 {
+  NSString * _Nullable x;
+  if (x) {
+    self.name = x;
+  }
+}
+
+@end
+
+@interface ParallelTest (Category)
+@end
+
+@implementation ParallelTest (Category)
+
+- (void)test5 {
+  NSString * _Nullable x;
+  NSString * _Nonnull y = x; // expected-warning{{Nullability mismatch on variable declaration}}
+}
+
+@end
@@ -23,5 +23,14 @@
   id a = @""; // expected-remark{{Variable nullability: nonnull}}
 }
 
+- (void)test3 {
+  NSString *x = @"", * _Nonnull y = x; // expected-remark{{Variable nullability: nonnull}}
+
+  id block = ^{ // expected-remark{{Variable nullability: nonnull}}
+    NSString *z = x; // expected-remark{{Variable nullability: nonnull}}
+    [self argumentIsNonnull:z]; // ok
+  };
+}
+
 @end
 
@@ -0,0 +1,29 @@
+#import "polyfill.h"
+
+@interface TryTest : NSObject
+
+- (BOOL)accept:(NSString * _Nonnull)string;
+
+@end
+
+@implementation TryTest
+
+- (BOOL)accept:(NSString * _Nonnull)string {
+  return YES;
+}
+
+- (void)test:(NSString * _Nullable)x {
+  // Methods with @try have no CFG; if and && still narrow the variable
+  @try {
+    if (x) {
+      NSString * _Nonnull a = x;
+    }
+
+    BOOL b = x && [self accept:x];
+
+    NSString * _Nonnull c = x; // expected-warning{{Nullability mismatch on variable declaration}}
+  } @finally {
+  }
+}
+
+@end
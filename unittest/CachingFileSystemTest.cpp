@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <llvm/Support/MemoryBuffer.h>
+#include <clang/Basic/VirtualFileSystem.h>
+
+#include <CachingFileSystem.h>
+
+using namespace clang;
+
+TEST(CachingFileSystem, status) {
+    llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> memory(new vfs::InMemoryFileSystem);
+    memory->addFile("/sdk/Foundation.h", 0, llvm::MemoryBuffer::getMemBuffer("@class NSObject;"));
+    
+    llvm::IntrusiveRefCntPtr<CachingFileSystem> fs(new CachingFileSystem(memory));
+    
+    auto status = fs->status("/sdk/Foundation.h");
+    ASSERT_TRUE((bool)status);
+    ASSERT_EQ("/sdk/Foundation.h", status->getName());
+    
+    // Missing path is remembered
+    ASSERT_FALSE((bool)fs->status("/sdk/UIKit.h"));
+    memory->addFile("/sdk/UIKit.h", 0, llvm::MemoryBuffer::getMemBuffer(""));
+    ASSERT_FALSE((bool)fs->status("/sdk/UIKit.h"));
+    ASSERT_FALSE((bool)fs->openFileForRead("/sdk/UIKit.h"));
+}
+
+TEST(CachingFileSystem, open_file) {
+    llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> memory(new vfs::InMemoryFileSystem);
+    memory->addFile("/sdk/Foundation.h", 0, llvm::MemoryBuffer::getMemBuffer("@class NSObject;"));
+    
+    llvm::IntrusiveRefCntPtr<CachingFileSystem> fs(new CachingFileSystem(memory));
+    
+    auto file = fs->openFileForRead("/sdk/Foundation.h");
+    ASSERT_TRUE((bool)file);
+    
+    auto buffer = (*file)->getBuffer("/sdk/Foundation.h");
+    ASSERT_TRUE((bool)buffer);
+    ASSERT_EQ("@class NSObject;", (*buffer)->getBuffer().str());
+    
+    // Failed open is remembered too
+    ASSERT_FALSE((bool)fs->openFileForRead("/sdk/UIKit.h"));
+    memory->addFile("/sdk/UIKit.h", 0, llvm::MemoryBuffer::getMemBuffer(""));
+    ASSERT_FALSE((bool)fs->status("/sdk/UIKit.h"));
+}
+
+TEST(CachingFileSystem, uncached_files) {
+    llvm::IntrusiveRefCntPtr<vfs::InMemoryFileSystem> memory(new vfs::InMemoryFileSystem);
+    memory->addFile("/sdk/Foundation.h", 0, llvm::MemoryBuffer::getMemBuffer("@class NSObject;"));
+    
+    llvm::IntrusiveRefCntPtr<CachingFileSystem> fs(new CachingFileSystem(memory));
+    fs->addUncachedPrefix("/cache/modules");
+    
+    // Files created by analyses are found after they are created
+    ASSERT_FALSE((bool)fs->status("/cache/modules/ABC/module.modulemap"));
+    memory->addFile("/cache/modules/ABC/module.modulemap", 0, llvm::MemoryBuffer::getMemBuffer(""));
+    ASSERT_TRUE((bool)fs->status("/cache/modules/ABC/module.modulemap"));
+    
+    // Module files are not cached anywhere
+    ASSERT_FALSE((bool)fs->status("/tmp/Foundation-1234.pcm"));
+    ASSERT_FALSE((bool)fs->openFileForRead("/tmp/Foundation-1234.pcm"));
+    memory->addFile("/tmp/Foundation-1234.pcm", 0, llvm::MemoryBuffer::getMemBuffer("CPCH"));
+    ASSERT_TRUE((bool)fs->status("/tmp/Foundation-1234.pcm"));
+    ASSERT_TRUE((bool)fs->openFileForRead("/tmp/Foundation-1234.pcm"));
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include <CompileConfiguration.h>
+
+TEST(CompileConfiguration, flags) {
+    std::vector<std::string> commandLine{ "clang", "-c", "-fmodules", "-isysroot", "/sdk", "src/Foo.m", "-o", "Foo.o", "-MF", "Foo.d" };
+    CompileConfiguration configuration(commandLine, "/project", "/project/src/Foo.m");
+    
+    std::vector<std::string> flags{ "-fmodules", "-isysroot", "/sdk" };
+    ASSERT_EQ(flags, configuration.getFlags());
+}
+
+TEST(CompileConfiguration, hash) {
+    CompileConfiguration foo({ "clang", "-fmodules", "/project/Foo.m" }, "/project", "/project/Foo.m");
+    CompileConfiguration bar({ "clang", "-fmodules", "Bar.m" }, "/project", "/project/Bar.m");
+    CompileConfiguration baz({ "clang", "-fmodules", "-DDEBUG=1", "Baz.m" }, "/project", "/project/Baz.m");
+    
+    ASSERT_EQ(foo.hash(), bar.hash());
+    ASSERT_NE(foo.hash(), baz.hash());
+    ASSERT_EQ(32u, foo.hash().size());
+}
+
+TEST(CompileConfiguration, modules_enabled) {
+    ASSERT_TRUE(CompileConfiguration({ "clang", "-fmodules", "Foo.m" }, "/", "/Foo.m").isModulesEnabled());
+    ASSERT_FALSE(CompileConfiguration({ "clang", "-fmodules", "-fno-modules", "Foo.m" }, "/", "/Foo.m").isModulesEnabled());
+    ASSERT_FALSE(CompileConfiguration({ "clang", "Foo.m" }, "/", "/Foo.m").isModulesEnabled());
+}
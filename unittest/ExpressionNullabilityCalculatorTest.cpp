@@ -64,6 +64,25 @@ TEST(ExpressionNullabilityCalculator, self_is_nonnull) {
     ASSERT_TRUE(calculator.calculate(init).isNonNull());
 }
 
+TEST(ExpressionNullabilityCalculator, self_in_block_is_nonnull) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)hello {\n"
+                       "  id block = ^{\n"
+                       "    id testee = self;\n"
+                       "  };\n"
+                       "}\n"
+                       "@end\n");
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env);
+    
+    auto init = builder.getTestExpr();
+    ASSERT_TRUE(calculator.calculate(init).isNonNull());
+}
+
 TEST(ExpressionNullabilityCalculator, var_ref_nullability_from_expression) {
     ASTBuilder builder("@interface Test : NSObject\n"
                        "@end\n"
@@ -103,6 +122,29 @@ TEST(ExpressionNullabilityCalculator, var_ref_nullability_from_env) {
     ASSERT_TRUE(calculator.calculate(init).isNonNull());
 };
 
+TEST(ExpressionNullabilityCalculator, cached_result_is_invalidated_by_env_update) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)hello {\n"
+                       "  NSObject * _Nullable x;\n"
+                       "  id testee = x;\n"
+                       "}\n"
+                       "@end\n");
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env);
+    
+    auto init = builder.getTestExpr();
+    ASSERT_FALSE(calculator.calculate(init).isNonNull());
+    
+    auto x = builder.getVarDecl("x");
+    env->set(x, x->getType().getTypePtr(), NullabilityKind::NonNull);
+    
+    ASSERT_TRUE(calculator.calculate(init).isNonNull());
+};
+
 TEST(ExpressionNullabilityCalculator, message_expr_is_nullable_if_method_returns_nullable) {
     ASTBuilder builder("@interface Test : NSObject\n"
                        "@end\n"
@@ -18,13 +18,13 @@ TEST(Filtering, clauses) {
     TextFilteringClause textClause2("NSURLSession");
     ASSERT_FALSE(textClause2.testClassName(subjects));
     
-    RegexpFilteringClause regexpClause1(std::regex("Object"));
+    RegexpFilteringClause regexpClause1("Object");
     ASSERT_TRUE(regexpClause1.testClassName(subjects));
 
-    RegexpFilteringClause regexpClause2(std::regex("XYZZY"));
+    RegexpFilteringClause regexpClause2("XYZZY");
     ASSERT_FALSE(regexpClause2.testClassName(subjects));
 
-    RegexpFilteringClause regexpClause3(std::regex("(^NS)"));
+    RegexpFilteringClause regexpClause3("(^NS)");
     ASSERT_TRUE(regexpClause3.testClassName(subjects));
 }
 
@@ -62,4 +62,41 @@ TEST(Filtering, filter_reject) {
     filter.addClause(std::shared_ptr<TextFilteringClause>{ new TextFilteringClause("XYZZY") });
     
     ASSERT_FALSE(filter.testClassName(subjects));
-}
\ No newline at end of file
+}
+
+TEST(Filtering, filter_combines_regexps) {
+    Filter filter;
+    filter.addClause(std::shared_ptr<TextFilteringClause>{ new TextFilteringClause("NSString") });
+    filter.addClause(std::shared_ptr<RegexpFilteringClause>{ new RegexpFilteringClause("^OBH") });
+    filter.addClause(std::shared_ptr<RegexpFilteringClause>{ new RegexpFilteringClause("Controller$") });
+    
+    ASSERT_TRUE(filter.testClassName("NSString"));
+    ASSERT_TRUE(filter.testClassName("OBHObject"));
+    ASSERT_TRUE(filter.testClassName("UIViewController"));
+    ASSERT_FALSE(filter.testClassName("NSObject"));
+    
+    // Verdicts are memoized
+    ASSERT_TRUE(filter.testClassName("OBHObject"));
+    ASSERT_FALSE(filter.testClassName("NSObject"));
+}
+
+TEST(Filtering, filter_pattern_added_after_test) {
+    Filter filter;
+    filter.addClause(std::shared_ptr<RegexpFilteringClause>{ new RegexpFilteringClause("^OBH") });
+    
+    ASSERT_FALSE(filter.testClassName("NSObject"));
+    
+    // Regexp is compiled again with the new pattern, and old verdicts are dropped
+    filter.addClause(std::shared_ptr<RegexpFilteringClause>{ new RegexpFilteringClause("^NS") });
+    
+    ASSERT_TRUE(filter.testClassName("NSObject"));
+    ASSERT_TRUE(filter.testClassName("OBHObject"));
+}
+
+TEST(Filtering, invalid_regexp) {
+    RegexpFilteringClause clause("(NS");
+    std::string error;
+    
+    ASSERT_FALSE(clause.isValid(error));
+    ASSERT_FALSE(error.empty());
+}
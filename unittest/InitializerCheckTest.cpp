@@ -55,13 +55,14 @@ TEST(InitializerCheck, find_nonnull_ivars) {
     
     ObjCImplementationDecl *impl = builder.getImplementationDecl("Test");
     
-    InitializerChecker checker(builder.getASTContext(), impl);
+    InitializerMethodCache initializerMethods;
+    InitializerChecker checker(builder.getASTContext(), impl, initializerMethods);
     
     auto ivars = checker.getNonnullIvars();
     
     std::set<std::string> actualIvarNames;
-    for (auto ivar : ivars) {
-        actualIvarNames.insert(ivar->getIvarDecl()->getNameAsString());
+    for (auto &ivar : ivars) {
+        actualIvarNames.insert(ivar.getIvarDecl()->getNameAsString());
     }
     
     std::set<std::string> expectedIvarNames;
@@ -70,4 +71,51 @@ TEST(InitializerCheck, find_nonnull_ivars) {
     expectedIvarNames.insert("_impl1");
     
     ASSERT_EQ(expectedIvarNames, actualIvarNames);
-}
\ No newline at end of file
+}
+TEST(InitializerCheck, check_branches) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@property (nonatomic, nonnull) NSString *a;\n"
+                       "@property (nonatomic, nonnull) NSString *b;\n"
+                       "@property (nonatomic, nonnull) NSString *c;\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (nonnull instancetype)initWithFlag:(BOOL)flag __attribute__((annotate(\"nlh_initializer\"))) {\n"
+                       "  if (flag) {\n"
+                       "    _a = @\"a\";\n"
+                       "    self.b = @\"b\";\n"
+                       "  } else {\n"
+                       "    _b = @\"b\";\n"
+                       "  }\n"
+                       "  return self;\n"
+                       "}\n"
+                       "@end\n");
+    
+    InitializerMethodCache initializerMethods;
+    InitializerChecker checker(builder.getASTContext(), builder.getImplementationDecl("Test"), initializerMethods);
+    
+    auto ivars = checker.check(builder.getMethodDecl("initWithFlag:"));
+    
+    // _b is initialized on both branches; reported in declaration order
+    ASSERT_EQ(ivars.size(), 2u);
+    ASSERT_EQ(ivars[0]->getIvarDecl()->getNameAsString(), "_a");
+    ASSERT_EQ(ivars[1]->getIvarDecl()->getNameAsString(), "_c");
+}
+
+TEST(InitializerCheck, initializer_method_cache) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (nonnull instancetype)init1 __attribute__((annotate(\"hoge\"))) {\n"
+                       "  return self;\n"
+                       "}\n"
+                       "- (nonnull instancetype)init2 __attribute__((annotate(\"nlh_initializer\"))) {\n"
+                       "  return self;\n"
+                       "}\n"
+                       "@end\n");
+    
+    InitializerMethodCache initializerMethods;
+    
+    ASSERT_FALSE(initializerMethods.isInitializerMethod(builder.getMethodDecl("init1")));
+    ASSERT_TRUE(initializerMethods.isInitializerMethod(builder.getMethodDecl("init2")));
+    ASSERT_TRUE(initializerMethods.isInitializerMethod(builder.getMethodDecl("init2")));
+}
@@ -256,3 +256,31 @@ TEST(MethodUtility, Class) {
     
     ASSERT_EQ(names, expected);
 }
+
+TEST(MethodUtility, cached_lookup) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@interface Foo : NSObject\n"
+                       "  - (nullable NSString *)foo;\n"
+                       "@end\n"
+                       "@interface Bar : Foo\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  Bar *x;\n"
+                       "  id y = [x foo];\n"
+                       "  id testee = [x foo];\n"
+                       "}\n"
+                       "@end\n");
+    
+    MethodUtility utility;
+    
+    const ObjCMessageExpr *first = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("y", true));
+    const ObjCMessageExpr *second = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("testee", true));
+    
+    // Second lookup is answered from cache, and gives the same result
+    ASSERT_EQ(utility.enumerateContainers(first), utility.enumerateContainers(second));
+    ASSERT_EQ(utility.interfaceForSelector(first->getInstanceReceiver(), first->getSelector()),
+              utility.interfaceForSelector(second->getInstanceReceiver(), second->getSelector()));
+    ASSERT_EQ(utility.interfaceForSelector(second->getInstanceReceiver(), second->getSelector())->getNameAsString(), "Foo");
+}
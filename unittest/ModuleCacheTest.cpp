@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <ModuleCache.h>
+
+TEST(ModuleCache, collect_imports) {
+    std::set<std::string> headers;
+    std::set<std::string> modules;
+    
+    ModuleCache::collectImports("#import <Foundation/Foundation.h>\n"
+                                "  # include <stdio.h>\n"
+                                "#import \"Foo.h\"\n"
+                                "@import UIKit;\n"
+                                "@import CoreData.NSManagedObject ;\n"
+                                "// #import <Commented/Out.h> is not an import\n",
+                                headers, modules);
+    
+    std::set<std::string> expectedHeaders{ "Foundation/Foundation.h", "stdio.h" };
+    std::set<std::string> expectedModules{ "CoreData.NSManagedObject", "UIKit" };
+    
+    ASSERT_EQ(expectedHeaders, headers);
+    ASSERT_EQ(expectedModules, modules);
+}
+
+static std::string writeFile(llvm::StringRef directory, llvm::StringRef name, llvm::StringRef content) {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, name);
+    
+    std::error_code error;
+    llvm::raw_fd_ostream os(path, error, llvm::sys::fs::F_None);
+    os << content;
+    
+    return path.str();
+}
+
+TEST(ModuleCache, collect_file_imports) {
+    llvm::SmallString<256> root;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("nullarihyon-modules-test", root));
+    
+    llvm::SmallString<256> include(root);
+    llvm::sys::path::append(include, "include");
+    ASSERT_FALSE(llvm::sys::fs::create_directory(include));
+    
+    // UIKit is imported only by Bar.h, which is found in the search path through Foo.h
+    std::string source = writeFile(root, "Foo.m", "#import \"Foo.h\"\n#import <Foundation/Foundation.h>\n");
+    std::string foo = writeFile(root, "Foo.h", "#import \"Bar.h\"\n#import \"Missing.h\"\n");
+    std::string bar = writeFile(include, "Bar.h", "#import \"Foo.h\"\n@import UIKit;\n#import <CoreData/CoreData.h>\n");
+    
+    std::set<std::string> headers;
+    std::set<std::string> modules;
+    ModuleCache::collectFileImports(source, ModuleCache::quotedSearchPaths({ "clang", "-iquote", "include", "Foo.m" }, root), headers, modules);
+    
+    std::set<std::string> expectedHeaders{ "CoreData/CoreData.h", "Foundation/Foundation.h" };
+    std::set<std::string> expectedModules{ "UIKit" };
+    
+    ASSERT_EQ(expectedHeaders, headers);
+    ASSERT_EQ(expectedModules, modules);
+    
+    llvm::sys::fs::remove(bar);
+    llvm::sys::fs::remove(include);
+    llvm::sys::fs::remove(foo);
+    llvm::sys::fs::remove(source);
+    llvm::sys::fs::remove(root);
+}
+
+TEST(ModuleCache, quoted_search_paths) {
+    std::vector<std::string> expected{ "/project/include", "/project/build/Foo.hmap", "/usr/include" };
+    ASSERT_EQ(expected, ModuleCache::quotedSearchPaths({ "clang", "-iquote", "include", "-Ibuild/Foo.hmap", "-I", "/usr/include", "-fmodules", "Foo.m" }, "/project"));
+}
+
+TEST(ModuleCache, import_source) {
+    std::string source = ModuleCache::importSource({ "Foundation/Foundation.h" }, { "UIKit" });
+    
+    ASSERT_EQ("#if __has_include(<Foundation/Foundation.h>)\n"
+              "#import <Foundation/Foundation.h>\n"
+              "#endif\n"
+              "@import UIKit;\n", source);
+}
+
+TEST(ModuleCache, adjust_command_line) {
+    ModuleCache cache("/tmp/nullarihyon-modules-test");
+    
+    std::vector<std::string> commandLine{ "clang", "-fmodules", "Foo.m" };
+    auto adjusted = cache.adjustCommandLine(commandLine, "/project", "/project/Foo.m");
+    
+    CompileConfiguration configuration(commandLine, "/project", "/project/Foo.m");
+    ASSERT_EQ("-fmodules-cache-path=" + cache.cachePath(configuration), adjusted[3]);
+    
+    // Command line without modules is not changed
+    std::vector<std::string> noModules{ "clang", "Foo.m" };
+    ASSERT_EQ(noModules, cache.adjustCommandLine(noModules, "/project", "/project/Foo.m"));
+}
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
+#include <algorithm>
+#include <set>
 
 #include <clang/Tooling/Tooling.h>
 #include <clang/ASTMatchers/ASTMatchers.h>
@@ -32,13 +34,15 @@ TEST(NullabilityDependencyCalculatorExpander, expand_conditional_operator) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), builder.getMethodDecl());
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), index);
     
     const ConditionalOperator *expr = llvm::dyn_cast<ConditionalOperator>(builder.getTestExpr()->IgnoreParenImpCasts());
     
     // The expr is nullable
     // both true and false
-    auto deps = expander.Visit(expr);
+    auto list = expander.Visit(expr);
+    std::set<const Expr *> deps(list.begin(), list.end());
     
     std::set<const Expr *> expected;
     expected.insert(expr->getTrueExpr());
@@ -64,11 +68,13 @@ TEST(NullabilityDependencyCalculatorExpander, call_nonnull_method) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), builder.getMethodDecl());
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), index);
     
     const ObjCMessageExpr *expr = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("testee", true));
     
-    auto deps = expander.Visit(expr);
+    auto list = expander.Visit(expr);
+    std::set<const Expr *> deps(list.begin(), list.end());
     
     // Because method has nonnull return type, receiver is the only source for nil
     // Does not check receiver's nullability
@@ -92,11 +98,13 @@ TEST(NullabilityDependencyCalculatorExpander, call_nullable_method) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), builder.getMethodDecl());
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), index);
     
     const ObjCMessageExpr *expr = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("testee", true));
     
-    auto deps = expander.Visit(expr);
+    auto list = expander.Visit(expr);
+    std::set<const Expr *> deps(list.begin(), list.end());
     
     // Because method has nullable return type, receiver and call expr may be source of il
     std::set<const Expr *> set;
@@ -123,11 +131,13 @@ TEST(NullabilityDependencyCalculatorExpander, var_ref) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), builder.getMethodDecl());
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), index);
     
     const Expr *expr = builder.getTestExpr("testee", true);
     
-    auto deps = expander.Visit(expr);
+    auto list = expander.Visit(expr);
+    std::set<const Expr *> deps(list.begin(), list.end());
     
     const VarDecl *decl = builder.getVarDecl("x");
     
@@ -155,11 +165,13 @@ TEST(NullabilityDependencyCalculatorExpander, var_ref_without_assignment) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), builder.getMethodDecl());
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    NullabilityDependencyExpandVisitor expander(builder.getASTContext(), index);
     
     const Expr *expr = builder.getTestExpr("testee", true);
     
-    auto deps = expander.Visit(expr);
+    auto list = expander.Visit(expr);
+    std::set<const Expr *> deps(list.begin(), list.end());
     
     // Expanded one step to empty
     std::set<const Expr *> set;
@@ -184,14 +196,73 @@ TEST(NullabilityDependencyCalculatorExpander, expand_recursively) {
     std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
     std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
     ExpressionNullabilityCalculator nullabilityCalculator(builder.getASTContext(), env);
-    NullabilityDependencyCalculator dependencyCalculator(builder.getASTContext());
+    llvm::BumpPtrAllocator allocator;
+    NullabilityDependencyCalculator dependencyCalculator(builder.getASTContext(), builder.getMethodDecl(), allocator);
     
     const Expr *expr = builder.getTestExpr("testee", true);
     
-    auto deps = dependencyCalculator.calculate(builder.getMethodDecl(), expr);
+    auto deps = dependencyCalculator.calculate(expr);
     
     // deps is transitive closure
-    ASSERT_NE(deps.find(builder.getVarDecl("x")->getInit()), deps.end());
-    ASSERT_NE(deps.find(builder.getVarDecl("y")->getInit()), deps.end());
-    ASSERT_NE(deps.find(builder.getVarDecl("z")->getInit()), deps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("x")->getInit()), deps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("y")->getInit()), deps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("z")->getInit()), deps.end());
+}
+
+TEST(VariableDefinitionIndex, lookup_definitions) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSNumber *x = @0;\n"
+                       "  NSNumber *y;\n"
+                       "  x = @1;\n"
+                       "  id testee = x;\n"
+                       "}\n"
+                       "@end\n");
+    
+    VariableDefinitionIndex index(builder.getMethodDecl());
+    
+    // Initializer and assignment
+    ASSERT_EQ(index.lookup(builder.getVarDecl("x")).size(), 2u);
+    ASSERT_EQ(index.lookup(builder.getVarDecl("x")).front(), builder.getVarDecl("x")->getInit()->IgnoreParenImpCasts());
+    
+    // No definition
+    ASSERT_TRUE(index.lookup(builder.getVarDecl("y")).empty());
+}
+
+TEST(NullabilityDependencyCalculator, reuse_memoized_closure) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSNumber *z = @2;\n"
+                       "  NSNumber *y = z;\n"
+                       "  NSNumber *x = y;\n"
+                       "  id testee = x;\n"
+                       "}\n"
+                       "@end\n");
+    
+    llvm::BumpPtrAllocator allocator;
+    NullabilityDependencyCalculator dependencyCalculator(builder.getASTContext(), builder.getMethodDecl(), allocator);
+    
+    // Closure of y's initializer is computed first, and reused while computing closure of testee
+    auto yDeps = dependencyCalculator.calculate(builder.getVarDecl("y")->getInit());
+    auto deps = dependencyCalculator.calculate(builder.getTestExpr("testee", true));
+    
+    ASSERT_NE(std::find(yDeps.begin(), yDeps.end(), builder.getVarDecl("z")->getInit()), yDeps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("x")->getInit()), deps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("y")->getInit()), deps.end());
+    ASSERT_NE(std::find(deps.begin(), deps.end(), builder.getVarDecl("z")->getInit()), deps.end());
+    
+    // Memoized closures come back as the same arrays, without computing or allocating again
+    size_t allocated = allocator.getBytesAllocated();
+    auto yDepsAgain = dependencyCalculator.calculate(builder.getVarDecl("y")->getInit());
+    auto depsAgain = dependencyCalculator.calculate(builder.getTestExpr("testee", true));
+    
+    ASSERT_EQ(yDeps.data(), yDepsAgain.data());
+    ASSERT_EQ(yDeps.size(), yDepsAgain.size());
+    ASSERT_EQ(deps.data(), depsAgain.data());
+    ASSERT_EQ(deps.size(), depsAgain.size());
+    ASSERT_EQ(allocated, allocator.getBytesAllocated());
 }
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include <clang/Tooling/Tooling.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+
+#include <ExpressionNullabilityCalculator.h>
+#include <NullabilityFlowAnalysis.h>
+
+#include "TestHelper.h"
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace clang::ast_matchers;
+
+TEST(NullabilityFlowAnalysis, if_narrows_variable_in_then_clause) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSObject * _Nullable x;\n"
+                       "  if (x) {\n"
+                       "    id a = x;\n"
+                       "  } else {\n"
+                       "    id b = x;\n"
+                       "  }\n"
+                       "  id c = x;\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilityFlowAnalysis flowAnalysis(builder.getASTContext(), builder.getMethodDecl());
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env, &flowAnalysis);
+    
+    ASSERT_TRUE(calculator.calculate(builder.getTestExpr("a")).isNonNull());
+    ASSERT_FALSE(calculator.calculate(builder.getTestExpr("b")).isNonNull());
+    ASSERT_FALSE(calculator.calculate(builder.getTestExpr("c")).isNonNull());
+}
+
+TEST(NullabilityFlowAnalysis, assignment_kills_narrowing) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSObject * _Nullable x;\n"
+                       "  NSObject * _Nullable y;\n"
+                       "  while (x) {\n"
+                       "    id a = x;\n"
+                       "    x = y;\n"
+                       "    id b = x;\n"
+                       "  }\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilityFlowAnalysis flowAnalysis(builder.getASTContext(), builder.getMethodDecl());
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env, &flowAnalysis);
+    
+    ASSERT_TRUE(calculator.calculate(builder.getTestExpr("a")).isNonNull());
+    ASSERT_FALSE(calculator.calculate(builder.getTestExpr("b")).isNonNull());
+}
+
+TEST(NullabilityFlowAnalysis, narrowing_reaches_block_body) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSObject * _Nullable x;\n"
+                       "  if (x) {\n"
+                       "    id block = ^{\n"
+                       "      id a = x;\n"
+                       "    };\n"
+                       "  }\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilityFlowAnalysis flowAnalysis(builder.getASTContext(), builder.getMethodDecl());
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env, &flowAnalysis);
+    
+    ASSERT_TRUE(calculator.calculate(builder.getTestExpr("a")).isNonNull());
+}
+
+TEST(NullabilityFlowAnalysis, narrows_on_syntax_without_cfg) {
+    // CFG is not built for @try; if and && conditions still narrow
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSObject * _Nullable x;\n"
+                       "  NSObject * _Nullable y;\n"
+                       "  @try {\n"
+                       "    if (x && y) {\n"
+                       "      id a = x;\n"
+                       "      id b = y;\n"
+                       "      y = x;\n"
+                       "      id c = y;\n"
+                       "    }\n"
+                       "    id d = x;\n"
+                       "  } @finally {\n"
+                       "  }\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilityFlowAnalysis flowAnalysis(builder.getASTContext(), builder.getMethodDecl());
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env, &flowAnalysis);
+    
+    ASSERT_TRUE(calculator.calculate(builder.getTestExpr("a")).isNonNull());
+    ASSERT_TRUE(calculator.calculate(builder.getTestExpr("b")).isNonNull());
+    ASSERT_FALSE(calculator.calculate(builder.getTestExpr("c")).isNonNull());
+    ASSERT_FALSE(calculator.calculate(builder.getTestExpr("d")).isNonNull());
+}
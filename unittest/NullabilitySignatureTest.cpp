@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include <clang/Tooling/Tooling.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+
+#include <NullabilitySignature.h>
+
+#include "TestHelper.h"
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace clang::ast_matchers;
+
+TEST(NullabilitySignatureCache, method_signature) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "- (nonnull NSString *)foo:(nullable NSString *)x bar:(nonnull NSString *)y;\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (NSString *)test_method {\n"
+                       "  return nil;\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilitySignatureCache cache(builder.getASTContext());
+    
+    const ObjCMethodDecl *method = *builder.getInterfaceDecl("Test")->meth_begin();
+    
+    auto &signature = cache.signature(method);
+    
+    ASSERT_EQ(2u, signature.getParams().size());
+    ASSERT_EQ(NullabilityKind::Nullable, signature.getParams()[0].getNullability());
+    ASSERT_EQ(NullabilityKind::NonNull, signature.getParams()[1].getNullability());
+    
+    ASSERT_EQ(&signature, &cache.signature(method));
+}
+
+TEST(NullabilitySignatureCache, block_compatibility) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSString * _Nonnull (^a)(NSString * _Nullable);\n"
+                       "  NSString * _Nonnull (^b)(NSString * _Nonnull);\n"
+                       "  NSString * _Nullable (^c)(NSString * _Nullable);\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilitySignatureCache cache(builder.getASTContext());
+    
+    const Type *a = builder.getVarDecl("a")->getType().getTypePtr();
+    const Type *b = builder.getVarDecl("b")->getType().getTypePtr();
+    const Type *c = builder.getVarDecl("c")->getType().getTypePtr();
+    
+    // Params are contravariant, and return is covariant
+    ASSERT_EQ(NullabilityCompatibility::Compatible, cache.compatibility(b, NullabilityKind::Nullable, a, NullabilityKind::Nullable));
+    ASSERT_EQ(NullabilityCompatibility::IncompatibleNested, cache.compatibility(a, NullabilityKind::Nullable, b, NullabilityKind::Nullable));
+    ASSERT_EQ(NullabilityCompatibility::IncompatibleNested, cache.compatibility(a, NullabilityKind::Nullable, c, NullabilityKind::Nullable));
+    
+    // Memoized result agrees
+    ASSERT_EQ(NullabilityCompatibility::IncompatibleNested, cache.compatibility(a, NullabilityKind::Nullable, b, NullabilityKind::Nullable));
+    
+    // Top level nullability is tested before block types
+    ASSERT_EQ(NullabilityCompatibility::IncompatibleTopLevel, cache.compatibility(b, NullabilityKind::NonNull, a, NullabilityKind::Nullable));
+}
+
+TEST(NullabilitySignatureCache, block_compatibility_disabled) {
+    ASTBuilder builder("@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  NSString * _Nonnull (^a)(NSString * _Nullable);\n"
+                       "  NSString * _Nonnull (^b)(NSString * _Nonnull);\n"
+                       "}\n"
+                       "@end\n");
+    
+    NullabilitySignatureCache cache(builder.getASTContext(), false);
+    
+    const Type *a = builder.getVarDecl("a")->getType().getTypePtr();
+    const Type *b = builder.getVarDecl("b")->getType().getTypePtr();
+    
+    // Block types are not tested, but top level nullability is
+    ASSERT_EQ(NullabilityCompatibility::Compatible, cache.compatibility(a, NullabilityKind::Nullable, b, NullabilityKind::Nullable));
+    ASSERT_EQ(NullabilityCompatibility::IncompatibleTopLevel, cache.compatibility(b, NullabilityKind::NonNull, a, NullabilityKind::Nullable));
+}
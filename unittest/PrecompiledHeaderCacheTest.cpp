@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <PrecompiledHeaderCache.h>
+
+TEST(PrecompiledHeaderCache, prefix_header_index) {
+    PrecompiledHeaderCache cache("/tmp/nullarihyon-pch-test", "/project/Prefix.pch");
+    
+    // Other -include options are not the prefix header, even if they come first
+    ASSERT_EQ(5u, cache.prefixHeaderIndex({ "clang", "-fmodules", "-include", "Other.h", "-include", "/project/Prefix.pch", "Foo.m" }, "/project"));
+    ASSERT_EQ(1u, cache.prefixHeaderIndex({ "-include", "Prefix.pch" }, "/project"));
+    ASSERT_EQ(3u, cache.prefixHeaderIndex({ "clang", "-include", "../project/Other.h", "-include", "../project/./Prefix.pch" }, "/project"));
+    ASSERT_EQ(0u, cache.prefixHeaderIndex({ "clang", "-include", "Other.h", "Foo.m" }, "/project"));
+    ASSERT_EQ(0u, cache.prefixHeaderIndex({ "clang", "Foo.m" }, "/project"));
+    
+    // -include without value is not a prefix header
+    ASSERT_EQ(0u, cache.prefixHeaderIndex({ "clang", "Foo.m", "-include" }, "/project"));
+}
+
+TEST(PrecompiledHeaderCache, parse_dependencies) {
+    auto dependencies = PrecompiledHeaderCache::parseDependencies("/tmp/prefix.pch-1a2b3c4d: /project/Prefix.pch \\\n"
+                                                                  "  /project/My\\ Headers/Foo.h /project/\\#Bar$$.h \\\n"
+                                                                  "  /cache/Foundation.pcm\n");
+    
+    std::vector<std::string> expected{ "/project/Prefix.pch", "/project/My Headers/Foo.h", "/project/#Bar$.h", "/cache/Foundation.pcm" };
+    ASSERT_EQ(expected, dependencies);
+    
+    ASSERT_TRUE(PrecompiledHeaderCache::parseDependencies("").empty());
+}
+
+TEST(PrecompiledHeaderCache, adjust_command_line_without_pch) {
+    PrecompiledHeaderCache cache("/tmp/nullarihyon-pch-test/does-not-exist", "/project/Prefix.pch");
+    
+    // Prefix header is included as before until PCH is built
+    std::vector<std::string> commandLine{ "clang", "-include", "Prefix.pch", "Foo.m" };
+    ASSERT_EQ(commandLine, cache.adjustCommandLine(commandLine, "/project", "/project/Foo.m"));
+    
+    std::vector<std::string> noPrefix{ "clang", "Foo.m" };
+    ASSERT_EQ(noPrefix, cache.adjustCommandLine(noPrefix, "/project", "/project/Foo.m"));
+}
+
+TEST(PrecompiledHeaderCache, parse_manifest) {
+    std::vector<PrecompiledHeaderDependency> dependencies{
+        { "/cache/prefix.pch", 1024, 1476662400, 123456789 },
+        { "/project/My Headers/Foo.h", 0, 1476662399, 0 },
+    };
+    
+    std::string text = PrecompiledHeaderCache::formatManifest(dependencies);
+    ASSERT_EQ("1024 1476662400 123456789 /cache/prefix.pch\n0 1476662399 0 /project/My Headers/Foo.h\n", text);
+    ASSERT_EQ(dependencies, PrecompiledHeaderCache::parseManifest(text));
+    
+    // Broken manifest has no dependencies, and PCH is out of date
+    ASSERT_TRUE(PrecompiledHeaderCache::parseManifest("1024 /cache/prefix.pch\n").empty());
+    ASSERT_TRUE(PrecompiledHeaderCache::parseManifest("").empty());
+}
+
+static void writeFile(llvm::StringRef path, llvm::StringRef content) {
+    std::error_code error;
+    llvm::raw_fd_ostream os(path, error, llvm::sys::fs::F_None);
+    os << content;
+}
+
+static void setModificationTime(llvm::StringRef path, llvm::sys::TimeValue time) {
+    int fd;
+    ASSERT_FALSE(llvm::sys::fs::openFileForWrite(path, fd, llvm::sys::fs::F_Append));
+    llvm::sys::fs::setLastModificationAndAccessTime(fd, time);
+    close(fd);
+}
+
+TEST(PrecompiledHeaderCache, up_to_date_with_same_size_and_time) {
+    llvm::SmallString<256> root;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("nullarihyon-pch-test", root));
+    
+    llvm::SmallString<256> header(root);
+    llvm::sys::path::append(header, "Prefix.pch");
+    writeFile(header, "@class Foo;\n");
+    
+    std::vector<std::string> commandLine{ "clang", "-include", "Prefix.pch", "Foo.m" };
+    CompileConfiguration configuration(commandLine, root, "Foo.m");
+    
+    std::string pchPath = PrecompiledHeaderCache(root, header).pchPath(configuration);
+    ASSERT_FALSE(llvm::sys::fs::create_directories(llvm::sys::path::parent_path(pchPath)));
+    writeFile(pchPath, "CPCH");
+    
+    PrecompiledHeaderDependency pch, prefix;
+    ASSERT_TRUE(PrecompiledHeaderDependency::stat(pchPath, pch));
+    ASSERT_TRUE(PrecompiledHeaderDependency::stat(header, prefix));
+    
+    llvm::SmallString<256> manifestPath(llvm::sys::path::parent_path(pchPath));
+    llvm::sys::path::append(manifestPath, "prefix.deps");
+    writeFile(manifestPath, PrecompiledHeaderCache::formatManifest({ pch, prefix }));
+    
+    ASSERT_TRUE(PrecompiledHeaderCache(root, header).isUpToDate(configuration));
+    
+    // Changed in the same second as the build, or restored with the old modification time
+    llvm::sys::fs::file_status status;
+    ASSERT_FALSE(llvm::sys::fs::status(header, status));
+    writeFile(header, "@class Foo, Bar;\n");
+    setModificationTime(header, status.getLastModificationTime());
+    
+    ASSERT_FALSE(PrecompiledHeaderCache(root, header).isUpToDate(configuration));
+    
+    std::vector<std::string> expected{ "clang", "-include", "Prefix.pch", "Foo.m" };
+    ASSERT_EQ(expected, PrecompiledHeaderCache(root, header).adjustCommandLine(commandLine, root, "Foo.m"));
+    
+    llvm::sys::fs::remove(manifestPath);
+    llvm::sys::fs::remove(pchPath);
+    llvm::sys::fs::remove(llvm::sys::path::parent_path(pchPath));
+    llvm::sys::fs::remove(header);
+    llvm::sys::fs::remove(root);
+}
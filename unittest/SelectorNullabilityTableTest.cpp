@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <iostream>
+
+#include <clang/Tooling/Tooling.h>
+#include <clang/ASTMatchers/ASTMatchers.h>
+#include <clang/ASTMatchers/ASTMatchFinder.h>
+
+#include <ExpressionNullabilityCalculator.h>
+#include <SelectorNullabilityTable.h>
+
+#include "TestHelper.h"
+
+using namespace clang;
+using namespace clang::tooling;
+using namespace clang::ast_matchers;
+
+TEST(SelectorNullabilityRules, parse) {
+    SelectorNullabilityRules rules;
+    std::string error;
+    
+    size_t builtins = rules.getRules().size();
+    
+    ASSERT_TRUE(rules.parse("# comment\n"
+                            "-objectEnumerator\n"
+                            "+sharedInstance nonnull  # class method\n"
+                            "-[Store itemForKey:] nullable\n", error));
+    
+    auto &added = rules.getRules();
+    ASSERT_EQ(builtins + 3, added.size());
+    
+    ASSERT_FALSE(added[builtins].ClassMethod);
+    ASSERT_EQ("objectEnumerator", added[builtins].Selector);
+    ASSERT_EQ(NullabilityKind::NonNull, added[builtins].Kind);
+    
+    ASSERT_TRUE(added[builtins + 1].ClassMethod);
+    ASSERT_EQ("sharedInstance", added[builtins + 1].Selector);
+    
+    ASSERT_EQ("Store", added[builtins + 2].ClassName);
+    ASSERT_EQ("itemForKey:", added[builtins + 2].Selector);
+    ASSERT_EQ(NullabilityKind::Nullable, added[builtins + 2].Kind);
+}
+
+TEST(SelectorNullabilityRules, parse_error) {
+    SelectorNullabilityRules rules;
+    std::string error;
+    
+    ASSERT_FALSE(rules.parse("objectEnumerator\n", error));
+    ASSERT_FALSE(rules.parse("-[Store itemForKey:\n", error));
+    ASSERT_FALSE(rules.parse("-objectEnumerator maybe\n", error));
+    
+    // Valid lines before the error are not added
+    size_t builtins = rules.getRules().size();
+    ASSERT_FALSE(rules.parse("-objectEnumerator\n-[Store itemForKey:\n", error));
+    ASSERT_EQ(builtins, rules.getRules().size());
+}
+
+TEST(SelectorNullabilityTable, lookup) {
+    ASTBuilder builder("@interface Store : NSObject\n"
+                       "+ (instancetype)sharedStore;\n"
+                       "- (id)itemForKey:(id)key;\n"
+                       "@end\n"
+                       "@interface SubStore : Store\n"
+                       "@end\n"
+                       "@interface Test : NSObject\n"
+                       "@end\n"
+                       "@implementation Test\n"
+                       "- (void)test_method {\n"
+                       "  id a = [Store sharedStore];\n"
+                       "  id b = [[SubStore sharedStore] itemForKey:@\"\"];\n"
+                       "  id c = [[Store alloc] init];\n"
+                       "}\n"
+                       "@end\n");
+    
+    SelectorNullabilityRules rules;
+    std::string error;
+    ASSERT_TRUE(rules.parse("+[Store sharedStore]\n"
+                            "-[Store itemForKey:] nonnull\n", error));
+    
+    SelectorNullabilityTable table(builder.getASTContext(), rules);
+    
+    auto a = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("a", true));
+    auto b = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("b", true));
+    auto c = llvm::dyn_cast<ObjCMessageExpr>(builder.getTestExpr("c", true));
+    
+    ASSERT_EQ(NullabilityKind::NonNull, table.lookup(a));
+    ASSERT_EQ(NullabilityKind::NonNull, table.lookup(b));
+    ASSERT_EQ(NullabilityKind::NonNull, table.lookup(c));
+    
+    std::shared_ptr<VariableNullabilityMapping> map(new VariableNullabilityMapping);
+    std::shared_ptr<VariableNullabilityEnvironment> env(new VariableNullabilityEnvironment(builder.getASTContext(), map));
+    ExpressionNullabilityCalculator calculator(builder.getASTContext(), env, nullptr, &table);
+    
+    ASSERT_TRUE(calculator.calculate(b).isNonNull());
+}